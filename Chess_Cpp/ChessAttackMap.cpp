@@ -0,0 +1,56 @@
+#include "ChessAttackMap.hpp"
+
+#include <algorithm>
+
+// static data members
+
+const unsigned ChessAttackMap::PLANE_COUNT;
+
+size_t ChessAttackMap::wordCount = 0;
+
+// class functions
+
+void ChessAttackMap::init(const ChessGameParameters &param)
+{
+	wordCount = (param.cellCount + 63) / 64;
+}
+
+ChessAttackMap::ChessAttackMap()
+	: words(nullptr)
+{}
+
+ChessAttackMap::~ChessAttackMap()
+{
+	release();
+}
+
+void ChessAttackMap::allocate()
+{
+	release();
+	words = new Word_t[2*PLANE_COUNT*wordCount]{};
+}
+
+void ChessAttackMap::release()
+{
+	delete[] words;
+	words = nullptr;
+}
+
+size_t ChessAttackMap::getFootprint() const
+{
+	return words ? 2*PLANE_COUNT*wordCount*sizeof(Word_t) : 0;
+}
+
+void ChessAttackMap::copy(ChessPlayerColour to, const ChessAttackMap &that, ChessPlayerColour from)
+{
+	std::copy(that.plane(from, 0), that.plane(from, 0) + PLANE_COUNT*wordCount, plane(to, 0));
+}
+
+bool ChessAttackMap::operator==(const ChessAttackMap &that) const
+{
+	if(!words || !that.words)
+	{
+		return words==that.words;
+	}
+	return std::equal(words, words + 2*PLANE_COUNT*wordCount, that.words);
+}
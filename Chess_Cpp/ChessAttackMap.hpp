@@ -0,0 +1,210 @@
+#ifndef CHESSATTACKMAP__
+#define CHESSATTACKMAP__
+
+#include "config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+#include "ChessPlayerColour.hpp"
+#include "ChessGameParameters.hpp"
+#include "ChessBitboard.hpp"
+
+// the counts of the attacks on the cells, for both colours in one block: the count of a cell is spread
+// over the planes of the colour, bit k of it in plane k (a set of cells of 64 bits per word).
+// so a set of attacked cells is added with a few set operations, and "attacked at least n times" or
+// "attacked more than by the other colour" are set operations too. the counts go modulo 2^PLANE_COUNT,
+// a count may go below 0 on the way as long as it is right in the end
+class ChessAttackMap
+{
+public:
+	typedef uint64_t Word_t;
+	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+
+	static const unsigned PLANE_COUNT = 7; // the counts up to 127, as the int8_t counters held
+private:
+	static size_t wordCount; // of a plane, for the board geometry
+
+	Word_t* words; // [colour][plane][word], nullptr if not calculated
+
+	Word_t* plane(ChessPlayerColour colour, unsigned k) const;
+	template<typename Geometry>
+	const Word_t* plane(const Geometry &geometry, ChessPlayerColour colour, unsigned k) const;
+
+	struct InitGeometry // the word count of init(), for the callers without a geometry
+	{
+		size_t wordCount() const { return ChessAttackMap::wordCount; }
+	};
+public:
+	static void init(const ChessGameParameters &param);
+
+	static size_t getWordCount();
+	static size_t wordOf(BoardPosition_t pos);
+	static Word_t bitOf(BoardPosition_t pos); // in its word
+
+	ChessAttackMap();
+	ChessAttackMap(const ChessAttackMap &that) = delete;
+	ChessAttackMap& operator=(const ChessAttackMap &that) = delete;
+	~ChessAttackMap();
+
+	void allocate(); // all the counts 0
+	void release();
+	bool isAllocated() const;
+	size_t getFootprint() const; // bytes of the planes
+
+	void increment(ChessPlayerColour colour, BoardPosition_t pos);
+	void decrement(ChessPlayerColour colour, BoardPosition_t pos);
+	void add(ChessPlayerColour colour, size_t word, Word_t cells); // one more on each of the cells of the word
+	void subtract(ChessPlayerColour colour, size_t word, Word_t cells); // one less on each of them
+	void add(ChessPlayerColour colour, const uint64_t &cells); // ChessBitboard::Set_t
+	void add(ChessPlayerColour colour, const ChessWideBitboardSet &cells);
+	void copy(ChessPlayerColour to, const ChessAttackMap &that, ChessPlayerColour from);
+
+	Word_t atLeast(ChessPlayerColour colour, unsigned n, size_t word) const; // the cells attacked n times or more
+	bool isAttacked(ChessPlayerColour colour, BoardPosition_t pos) const;
+	void compare(size_t word, Word_t &whiteMore, Word_t &blackMore) const; // the cells one colour attacks more than the other
+	template<typename Geometry> // the same with the layout of the planes folded, see dispatchGeometry
+	void compare(const Geometry &geometry, size_t word, Word_t &whiteMore, Word_t &blackMore) const;
+	int dominance(BoardPosition_t pos) const; // 1 if white attacks the cell more, -1 if black, 0 if the same
+
+	bool operator==(const ChessAttackMap &that) const;
+};
+
+inline size_t ChessAttackMap::getWordCount()
+{
+	return wordCount;
+}
+inline size_t ChessAttackMap::wordOf(BoardPosition_t pos)
+{
+	return pos >> 6;
+}
+inline ChessAttackMap::Word_t ChessAttackMap::bitOf(BoardPosition_t pos)
+{
+	return Word_t(1) << (pos & 63);
+}
+inline ChessAttackMap::Word_t* ChessAttackMap::plane(ChessPlayerColour colour, unsigned k) const
+{
+	return words + (toArrayPosition(colour)*PLANE_COUNT + k)*wordCount;
+}
+inline bool ChessAttackMap::isAllocated() const
+{
+	return words!=nullptr;
+}
+
+inline void ChessAttackMap::increment(ChessPlayerColour colour, BoardPosition_t pos)
+{
+	const size_t word = wordOf(pos);
+	const Word_t bit = bitOf(pos);
+	for(unsigned k=0; k<PLANE_COUNT; ++k)
+	{
+		Word_t &w = plane(colour, k)[word];
+		w ^= bit;
+		if(w & bit)
+		{
+			break; // it was 0, nothing to carry
+		}
+	}
+}
+inline void ChessAttackMap::decrement(ChessPlayerColour colour, BoardPosition_t pos)
+{
+	const size_t word = wordOf(pos);
+	const Word_t bit = bitOf(pos);
+	for(unsigned k=0; k<PLANE_COUNT; ++k)
+	{
+		Word_t &w = plane(colour, k)[word];
+		w ^= bit;
+		if(!(w & bit))
+		{
+			break; // it was 1, nothing to borrow
+		}
+	}
+}
+inline void ChessAttackMap::add(ChessPlayerColour colour, size_t word, Word_t cells)
+{
+	// the carries of all the cells at once
+	for(unsigned k=0; k<PLANE_COUNT && cells; ++k)
+	{
+		Word_t &w = plane(colour, k)[word];
+		const Word_t carry = w & cells;
+		w ^= cells;
+		cells = carry;
+	}
+}
+inline void ChessAttackMap::subtract(ChessPlayerColour colour, size_t word, Word_t cells)
+{
+	for(unsigned k=0; k<PLANE_COUNT && cells; ++k)
+	{
+		Word_t &w = plane(colour, k)[word];
+		const Word_t borrow = ~w & cells;
+		w ^= cells;
+		cells = borrow;
+	}
+}
+inline void ChessAttackMap::add(ChessPlayerColour colour, const uint64_t &cells)
+{
+	add(colour, 0, cells);
+}
+inline void ChessAttackMap::add(ChessPlayerColour colour, const ChessWideBitboardSet &cells)
+{
+	add(colour, 0, cells.lo);
+	add(colour, 1, cells.hi);
+}
+
+inline ChessAttackMap::Word_t ChessAttackMap::atLeast(ChessPlayerColour colour, unsigned n, size_t word) const
+{
+	// the count against n from the top bit: the cells above n so far, and the ones equal to it so far
+	Word_t above = 0, equal = ~Word_t(0);
+	for(unsigned k=PLANE_COUNT; k-- > 0; )
+	{
+		const Word_t w = plane(colour, k)[word];
+		if(n & (1u << k))
+		{
+			equal &= w;
+		}
+		else
+		{
+			above |= equal & w;
+			equal &= ~w;
+		}
+	}
+	return above | equal;
+}
+inline bool ChessAttackMap::isAttacked(ChessPlayerColour colour, BoardPosition_t pos) const
+{
+	return (atLeast(colour, 1, wordOf(pos)) & bitOf(pos)) != 0;
+}
+template<typename Geometry>
+inline const ChessAttackMap::Word_t* ChessAttackMap::plane(const Geometry &geometry, ChessPlayerColour colour, unsigned k) const
+{
+	return words + (toArrayPosition(colour)*PLANE_COUNT + k)*geometry.wordCount();
+}
+inline void ChessAttackMap::compare(size_t word, Word_t &whiteMore, Word_t &blackMore) const
+{
+	compare(InitGeometry(), word, whiteMore, blackMore);
+}
+template<typename Geometry>
+inline void ChessAttackMap::compare(const Geometry &geometry, size_t word, Word_t &whiteMore, Word_t &blackMore) const
+{
+	assert(geometry.wordCount()==wordCount);
+	// from the top bit, the first one that differs decides
+	Word_t equal = ~Word_t(0);
+	whiteMore = blackMore = 0;
+	for(unsigned k=PLANE_COUNT; k-- > 0; )
+	{
+		const Word_t white = plane(geometry, ChessPlayerColour::WHITE, k)[word];
+		const Word_t black = plane(geometry, ChessPlayerColour::BLACK, k)[word];
+		whiteMore |= equal & white & ~black;
+		blackMore |= equal & black & ~white;
+		equal &= ~(white ^ black);
+	}
+}
+inline int ChessAttackMap::dominance(BoardPosition_t pos) const
+{
+	Word_t whiteMore, blackMore;
+	compare(wordOf(pos), whiteMore, blackMore);
+	const Word_t bit = bitOf(pos);
+	return (whiteMore & bit) ? 1 : (blackMore & bit) ? -1 : 0;
+}
+
+#endif
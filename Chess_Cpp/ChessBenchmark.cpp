@@ -0,0 +1,204 @@
+#include "ChessBenchmark.hpp"
+#include "ChessBoardAnalysis.hpp"
+#include "ChessBoardGeometry.hpp"
+#include "ChessBoardFactory.hpp"
+#include "ChessPositionCodec.hpp"
+
+#include <vector>
+#include <chrono>
+#include <cassert>
+
+// helper
+
+static volatile uint64_t sink; // the sums of the timed loops, so they are not optimised away
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// class functions
+
+double ChessBenchmark::Result::getRate() const
+{
+	return seconds > 0 ? count / seconds : 0;
+}
+
+ChessBenchmark::Result ChessBenchmark::positionCodec(ChessBoard::ptr board, size_t rounds)
+{
+	ChessBoardFactory factory;
+	
+	// the position and the ones after each of its moves
+	std::vector<ChessBoard::ptr> positions(1, board);
+	board->makeIFrame();
+	ChessBoardAnalysis* analysis = ChessBoard::getAnalysis(board);
+	analysis->calculatePossibleMoves();
+	for(size_t i=0, end=analysis->getPossibleMoves()->size(); i<end; ++i)
+	{
+		positions.push_back(analysis->getPossibleMove(i));
+		positions.back()->makeIFrame();
+	}
+	
+	std::vector<ChessBoard::ptr> decoded;
+	for(size_t i=0, end=positions.size(); i<end; ++i)
+	{
+		decoded.push_back(factory.createBoard());
+	}
+	std::vector<uint8_t> buffer(positions.size() * ChessPositionCodec::getMaxSize());
+	
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t round=0; round<rounds; ++round)
+	{
+		const size_t size = ChessPositionCodec::encode(positions.data(), positions.size(), buffer.data(), buffer.size());
+		const size_t read = ChessPositionCodec::decode(buffer.data(), size, decoded.data(), decoded.size());
+		assert(size!=0 && read==size);
+	}
+	const double seconds = secondsSince(start);
+	
+	for(size_t i=0, end=positions.size(); i<end; ++i)
+	{
+		assert(decoded[i]->getHash()==positions[i]->getHash());
+	}
+	board->clearPossibleMoves();
+	
+	return Result{ "position codec (encode and decode)", rounds * positions.size(), seconds };
+}
+
+ChessBenchmark::Result ChessBenchmark::moveGeneration(ChessBoard::ptr board, size_t rounds)
+{
+	std::vector<ChessBoard::ptr> positions(1, board);
+	board->makeIFrame();
+	ChessBoardAnalysis* analysis = ChessBoard::getAnalysis(board);
+	analysis->calculatePossibleMoves();
+	for(size_t i=0, end=analysis->getPossibleMoves()->size(); i<end; ++i)
+	{
+		positions.push_back(analysis->getPossibleMove(i));
+		positions.back()->makeIFrame();
+	}
+	std::vector<ChessBoardAnalysis*> analyses;
+	for(auto &position : positions)
+	{
+		analyses.push_back(ChessBoard::getAnalysis(position));
+	}
+	
+	uint64_t moves = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t round=0; round<rounds; ++round)
+	{
+		// the root keeps its moves, they hold the other positions
+		for(size_t i=1, end=analyses.size(); i<end; ++i)
+		{
+			analyses[i]->reset();
+			analyses[i]->calculatePossibleMoves();
+			moves += analyses[i]->getPossibleMoves()->size();
+		}
+	}
+	const double seconds = secondsSince(start);
+	assert(moves!=0);
+	board->clearPossibleMoves();
+	
+	return Result{ "move generation (positions)", rounds * (positions.size()-1), seconds };
+}
+
+ChessBenchmark::Result ChessBenchmark::evaluation(ChessBoard::ptr board, size_t rounds)
+{
+	std::vector<ChessBoard::ptr> positions(1, board);
+	board->makeIFrame();
+	ChessBoardAnalysis* analysis = ChessBoard::getAnalysis(board);
+	analysis->calculatePossibleMoves();
+	for(size_t i=0, end=analysis->getPossibleMoves()->size(); i<end; ++i)
+	{
+		positions.push_back(analysis->getPossibleMove(i));
+		positions.back()->makeIFrame();
+	}
+	std::vector<ChessBoardAnalysis*> analyses;
+	for(auto &position : positions)
+	{
+		analyses.push_back(ChessBoard::getAnalysis(position));
+		analyses.back()->startPossibleMoves(); // the attack maps
+	}
+	
+	// the specialised kernels give what the runtime geometry does
+	const ChessRuntimeGeometry runtime(ChessBoard::param);
+	for(auto a : analyses)
+	{
+		assert(a->chessPieceAttackedWeight() == a->chessPieceAttackedWeight(runtime));
+		assert(a->chessCentreControlWeight() == a->chessCentreControlWeight(runtime));
+	}
+	
+	ChessBoardAnalysis::weight_type sum = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t round=0; round<rounds; ++round)
+	{
+		for(auto a : analyses)
+		{
+			sum += a->chessPositionWeight();
+		}
+	}
+	const double seconds = secondsSince(start);
+	sink = (uint64_t)sum;
+	board->clearPossibleMoves();
+	
+	return Result{ "evaluation (positions, " + std::to_string(ChessBoard::param.width) + "x" + std::to_string(ChessBoard::param.height) + ")",
+		rounds * analyses.size(), seconds };
+}
+
+ChessBenchmark::Result ChessBenchmark::sliderAttacks(ChessBoard::ptr board, size_t rounds)
+{
+	assert(ChessBoard::param.cellCount <= ChessMagic::MAX_CELL_COUNT);
+	
+	// the occupied cells of the position and of the ones after each of its moves
+	std::vector<ChessBoard::ptr> positions(1, board);
+	board->makeIFrame();
+	ChessBoardAnalysis* analysis = ChessBoard::getAnalysis(board);
+	analysis->calculatePossibleMoves();
+	for(size_t i=0, end=analysis->getPossibleMoves()->size(); i<end; ++i)
+	{
+		positions.push_back(analysis->getPossibleMove(i));
+		positions.back()->makeIFrame();
+	}
+	std::vector<ChessMagic::Set_t> occupancies;
+	for(auto &position : positions)
+	{
+		ChessMagic::Set_t occupied = 0;
+		for(ChessBoard::BoardPosition_t pos=0; pos<ChessBoard::param.cellCount; ++pos)
+		{
+			if(!position->isEmptyPos(pos))
+			{
+				occupied |= bitAt<ChessMagic::Set_t>(pos);
+			}
+		}
+		occupancies.push_back(occupied);
+	}
+	board->clearPossibleMoves();
+	
+	ChessMagic::Set_t sum = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t round=0; round<rounds; ++round)
+	{
+		for(const auto &occupied : occupancies)
+		{
+			for(ChessBoard::BoardPosition_t pos=0; pos<ChessBoard::param.cellCount; ++pos)
+			{
+				sum += ChessMagic::rookAttacks(pos, occupied) ^ ChessMagic::bishopAttacks(pos, occupied);
+			}
+		}
+	}
+	const double seconds = secondsSince(start);
+	sink = sum;
+	
+	return Result{ std::string("slider attacks (") + (ChessMagic::getStatistics().pext ? "PEXT" : "magic") + ")",
+		rounds * occupancies.size() * ChessBoard::param.cellCount * 2, seconds };
+}
+
+void ChessBenchmark::print(std::ostream &os, const Result &result)
+{
+	os << result.name << ": " << result.count << " in " << result.seconds << " s, "
+		<< (uint64_t)result.getRate() << " per second" << std::endl;
+}
+
+void ChessBenchmark::print(std::ostream &os, const ChessMagic::Statistics &statistics)
+{
+	os << "slider tables (" << (statistics.pext ? "PEXT" : "magic") << "): " << statistics.footprint << " bytes, built in "
+		<< statistics.initSeconds << " s" << std::endl;
+}
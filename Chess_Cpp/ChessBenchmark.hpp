@@ -0,0 +1,40 @@
+#ifndef CHESSBENCHMARK__
+#define CHESSBENCHMARK__
+
+#include "config.hpp"
+
+#include <string>
+#include <ostream>
+#include <cstdint>
+
+#include "ChessBoard.hpp"
+#include "ChessMagic.hpp"
+
+// the throughput of the parts of the engine, run with "Chess_Cpp bench"
+class ChessBenchmark
+{
+public:
+	struct Result
+	{
+		std::string name;
+		uint64_t count; // of the positions, the moves etc.
+		double seconds;
+
+		double getRate() const; // count per second
+	};
+
+	// encoding and decoding board and the positions after each of its moves, rounds times
+	static Result positionCodec(ChessBoard::ptr board, size_t rounds);
+	// the possible moves of board and of the positions after each of its moves, calculated rounds times
+	static Result moveGeneration(ChessBoard::ptr board, size_t rounds);
+	// the evaluation of board and of the positions after each of its moves, rounds times;
+	// the geometry dispatchGeometry picks is checked against ChessRuntimeGeometry on them first
+	static Result evaluation(ChessBoard::ptr board, size_t rounds);
+	// the rook and bishop attacks of every cell with the pieces of board (a 64 cell one) in the way, rounds times
+	static Result sliderAttacks(ChessBoard::ptr board, size_t rounds);
+
+	static void print(std::ostream &os, const Result &result);
+	static void print(std::ostream &os, const ChessMagic::Statistics &statistics);
+};
+
+#endif
@@ -0,0 +1,296 @@
+#include "ChessBitboard.hpp"
+#include "ChessMagic.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+// static data members
+
+template<typename Set> const typename ChessBitboardBase<Set>::BoardPosition_t ChessBitboardBase<Set>::MAX_CELL_COUNT;
+
+template<typename Set> typename ChessBitboardBase<Set>::BoardPosition_t ChessBitboardBase<Set>::width = 0;
+template<typename Set> Set ChessBitboardBase<Set>::boardCells;
+template<typename Set> Set ChessBitboardBase<Set>::filesFrom[ChessBitboardBase<Set>::MAX_CELL_COUNT+1];
+template<typename Set> Set ChessBitboardBase<Set>::filesBelow[ChessBitboardBase<Set>::MAX_CELL_COUNT+1];
+template<typename Set> Set ChessBitboardBase<Set>::rays[ChessBitboardBase<Set>::DIRECTION_COUNT][ChessBitboardBase<Set>::MAX_CELL_COUNT];
+template<typename Set> bool ChessBitboardBase<Set>::rayGoesUp[ChessBitboardBase<Set>::DIRECTION_COUNT];
+template<typename Set> Set ChessBitboardBase<Set>::knightAttacks[ChessBitboardBase<Set>::MAX_CELL_COUNT];
+template<typename Set> Set ChessBitboardBase<Set>::kingAttacks[ChessBitboardBase<Set>::MAX_CELL_COUNT];
+template<typename Set> Set ChessBitboardBase<Set>::pawnTake[2][ChessBitboardBase<Set>::MAX_CELL_COUNT];
+template<typename Set> Set ChessBitboardBase<Set>::pawnNoTake[2][ChessBitboardBase<Set>::MAX_CELL_COUNT];
+
+// class functions
+
+template<typename Set>
+bool ChessBitboardBase<Set>::isSupported(const ChessGameParameters &param)
+{
+	return param.cellCount <= MAX_CELL_COUNT;
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::lowCells(BoardPosition_t count)
+{
+	return count>=MAX_CELL_COUNT ? ~Set_t(0) : ~(~Set_t(0) << count);
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::shift(const Set_t &s, int fileShift, int rankShift)
+{
+	const int w = width;
+	if(fileShift >= w || -fileShift >= w)
+	{
+		return Set_t(0);
+	}
+	
+	// cells that would wrap around to the neighbouring rank
+	Set_t result = s & (fileShift>0 ? filesBelow[w-fileShift] : filesFrom[-fileShift]);
+	
+	const int distance = fileShift + rankShift*w;
+	if(distance >= (int)MAX_CELL_COUNT || -distance >= (int)MAX_CELL_COUNT)
+	{
+		return Set_t(0);
+	}
+	result = distance>0 ? result << distance : result >> -distance;
+	
+	return result & boardCells;
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::walk(BoardPosition_t pos, const MoveTemplate &mt)
+{
+	const Set_t from = bitAt<Set_t>(pos);
+	
+	Set_t result = 0;
+	for(auto direction = mt.begin(), directionEnd=mt.end(); direction != directionEnd; ++direction)
+	{
+		for(auto attempt = direction->begin(), attemptEnd=direction->end(); attempt != attemptEnd; ++attempt)
+		{
+			const Set_t to = shift(from, attempt->first, attempt->second);
+			if(!to)
+			{
+				break;
+			}
+			result |= to;
+		}
+	}
+	return result;
+}
+
+template<typename Set>
+void ChessBitboardBase<Set>::init(const ChessGameParameters &param)
+{
+	assert(isSupported(param));
+	
+	width = param.width;
+	boardCells = lowCells(param.cellCount);
+	for(BoardPosition_t n=0; n<=width; ++n)
+	{
+		filesFrom[n] = filesBelow[n] = 0;
+		for(BoardPosition_t pos=0; pos<param.cellCount; ++pos)
+		{
+			if(pos % width >= n)
+			{
+				filesFrom[n] |= bitAt<Set_t>(pos);
+			}
+			else
+			{
+				filesBelow[n] |= bitAt<Set_t>(pos);
+			}
+		}
+	}
+
+	const MoveTemplate* rayTemplates[2] = { &rookMove, &bishopMove };
+	size_t dir = 0;
+	for(auto mt : rayTemplates)
+	{
+		for(auto direction = mt->begin(), directionEnd=mt->end(); direction != directionEnd; ++direction, ++dir)
+		{
+			const auto &step = direction->front();
+			rayGoesUp[dir] = step.first + step.second * (int)param.width > 0;
+
+			const MoveTemplate single = { *direction };
+			for(BoardPosition_t pos=0; pos<param.cellCount; ++pos)
+			{
+				rays[dir][pos] = walk(pos, single);
+			}
+		}
+	}
+	assert(dir==DIRECTION_COUNT);
+
+	for(BoardPosition_t pos=0; pos<param.cellCount; ++pos)
+	{
+		knightAttacks[pos] = walk(pos, knightMove);
+		kingAttacks[pos] = walk(pos, kingMove);
+		pawnTake[toArrayPosition(ChessPlayerColour::WHITE)][pos] = walk(pos, pawnWhiteMoveTake);
+		pawnTake[toArrayPosition(ChessPlayerColour::BLACK)][pos] = walk(pos, pawnBlackMoveTake);
+		pawnNoTake[toArrayPosition(ChessPlayerColour::WHITE)][pos] = walk(pos, pawnWhiteMoveNoTake);
+		pawnNoTake[toArrayPosition(ChessPlayerColour::BLACK)][pos] = walk(pos, pawnBlackMoveNoTake);
+	}
+}
+
+template<typename Set>
+void ChessBitboardBase<Set>::clear(BoardPosition_t cellCount)
+{
+	std::fill(pieces, pieces+KNOWN_CHESS_PIECE_COUNT, Set_t(0));
+	colours[0] = colours[1] = occupied = Set_t(0);
+	pieces[EMPTY_CELL] = lowCells(cellCount);
+}
+
+template<typename Set>
+void ChessBitboardBase<Set>::placePiece(BoardPosition_t pos, ChessPiece oldPiece, ChessPiece newPiece)
+{
+	const Set_t bit = bitAt<Set_t>(pos);
+
+	pieces[oldPiece] ^= bit;
+	pieces[newPiece] ^= bit;
+	if(oldPiece!=EMPTY_CELL)
+	{
+		colours[toArrayPosition(::getColour(oldPiece))] ^= bit;
+	}
+	if(newPiece!=EMPTY_CELL)
+	{
+		colours[toArrayPosition(::getColour(newPiece))] ^= bit;
+	}
+	occupied = colours[0] | colours[1];
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::getPieces(ChessPiece piece) const
+{
+	return pieces[piece];
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::getColour(ChessPlayerColour colour) const
+{
+	return colours[toArrayPosition(colour)];
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::getOccupied() const
+{
+	return occupied;
+}
+
+template<typename Set>
+int ChessBitboardBase<Set>::count(ChessPiece piece) const
+{
+	return bitCount(pieces[piece]);
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::rayAttacks(Direction dir, BoardPosition_t pos) const
+{
+	Set_t result = rays[dir][pos];
+	const Set_t blockers = result & occupied;
+	if(blockers)
+	{
+		// everything behind the nearest blocker is not reachable
+		result ^= rays[dir][ rayGoesUp[dir] ? bitScanForward(blockers) : bitScanReverse(blockers) ];
+	}
+	return result;
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::rookAttacks(BoardPosition_t pos) const
+{
+	return rayAttacks(NORTH, pos) | rayAttacks(SOUTH, pos) | rayAttacks(WEST, pos) | rayAttacks(EAST, pos);
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::bishopAttacks(BoardPosition_t pos) const
+{
+	return rayAttacks(NORTH_EAST, pos) | rayAttacks(SOUTH_EAST, pos) | rayAttacks(NORTH_WEST, pos) | rayAttacks(SOUTH_WEST, pos);
+}
+
+template<>
+ChessBitboardSet ChessBitboard::rookAttacks(BoardPosition_t pos) const
+{
+	return ChessMagic::rookAttacks(pos, occupied);
+}
+
+template<>
+ChessBitboardSet ChessBitboard::bishopAttacks(BoardPosition_t pos) const
+{
+	return ChessMagic::bishopAttacks(pos, occupied);
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::attacks(ChessPiece piece, BoardPosition_t pos) const
+{
+	switch(piece)
+	{
+	case PAWN_WHITE:
+		return pawnTake[toArrayPosition(ChessPlayerColour::WHITE)][pos];
+	case PAWN_BLACK:
+		return pawnTake[toArrayPosition(ChessPlayerColour::BLACK)][pos];
+	case ROOK_WHITE: case ROOK_BLACK:
+		return rookAttacks(pos);
+	case KNIGHT_WHITE: case KNIGHT_BLACK:
+		return knightAttacks[pos];
+	case BISHOP_WHITE: case BISHOP_BLACK:
+		return bishopAttacks(pos);
+	case KING_WHITE: case KING_BLACK:
+		return kingAttacks[pos];
+	case QUEEN_WHITE: case QUEEN_BLACK:
+		return rookAttacks(pos) | bishopAttacks(pos);
+	case PRINCESS_WHITE: case PRINCESS_BLACK:
+		return bishopAttacks(pos) | knightAttacks[pos];
+	case EMPRESS_WHITE: case EMPRESS_BLACK:
+		return rookAttacks(pos) | knightAttacks[pos];
+	case AMAZON_WHITE: case AMAZON_BLACK:
+		return rookAttacks(pos) | bishopAttacks(pos) | knightAttacks[pos];
+	default:
+		return Set_t(0);
+	}
+}
+
+template<typename Set>
+Set ChessBitboardBase<Set>::quietMoves(ChessPiece piece, BoardPosition_t pos) const
+{
+	if(piece==PAWN_WHITE || piece==PAWN_BLACK)
+	{
+		return pawnNoTake[toArrayPosition(::getColour(piece))][pos];
+	}
+	return Set_t(0);
+}
+
+template<typename Set>
+bool ChessBitboardBase<Set>::isAttacked(BoardPosition_t pos, ChessPlayerColour by) const
+{
+	// white pieces are odd, the black ones follow them
+	const ChessPiece c = (ChessPiece)toArrayPosition(by);
+
+	// a pawn of 'by' attacks pos if a pawn of the other colour standing on pos would attack it
+	if(pawnTake[toArrayPosition(!by)][pos] & pieces[PAWN_WHITE+c])
+	{
+		return true;
+	}
+	if(knightAttacks[pos] &
+		(pieces[KNIGHT_WHITE+c] | pieces[PRINCESS_WHITE+c] | pieces[EMPRESS_WHITE+c] | pieces[AMAZON_WHITE+c]))
+	{
+		return true;
+	}
+	if(kingAttacks[pos] & pieces[KING_WHITE+c])
+	{
+		return true;
+	}
+	const Set_t rookLike =
+		pieces[ROOK_WHITE+c] | pieces[QUEEN_WHITE+c] | pieces[EMPRESS_WHITE+c] | pieces[AMAZON_WHITE+c];
+	if(rookLike && (rookAttacks(pos) & rookLike))
+	{
+		return true;
+	}
+	const Set_t bishopLike =
+		pieces[BISHOP_WHITE+c] | pieces[QUEEN_WHITE+c] | pieces[PRINCESS_WHITE+c] | pieces[AMAZON_WHITE+c];
+	if(bishopLike && (bishopAttacks(pos) & bishopLike))
+	{
+		return true;
+	}
+	return false;
+}
+
+// the instantiations in use
+
+template class ChessBitboardBase<ChessBitboardSet>;
+template class ChessBitboardBase<ChessWideBitboardSet>;
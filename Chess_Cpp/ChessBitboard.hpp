@@ -0,0 +1,184 @@
+#ifndef CHESSBITBOARD__
+#define CHESSBITBOARD__
+
+#include "config.hpp"
+
+#include <cstdint>
+
+#include "ChessPiece.hpp"
+#include "ChessPlayerColour.hpp"
+#include "ChessGameParameters.hpp"
+#include "moveTemplate.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// bit number is rank*w+file, the same as in the cell array
+
+typedef uint64_t ChessBitboardSet;
+
+struct ChessWideBitboardSet // for the boards up to 128 cells (10x8 etc.), two words instead of unsigned __int128
+{
+	uint64_t lo; // cells 0..63
+	uint64_t hi; // cells 64..127
+
+	constexpr ChessWideBitboardSet(uint64_t lo_=0, uint64_t hi_=0)
+	: lo(lo_), hi(hi_)
+	{}
+
+	constexpr explicit operator bool() const { return (lo | hi) != 0; }
+	constexpr bool operator==(const ChessWideBitboardSet &that) const { return lo==that.lo && hi==that.hi; }
+	constexpr bool operator!=(const ChessWideBitboardSet &that) const { return !operator==(that); }
+
+	constexpr ChessWideBitboardSet operator~() const { return ChessWideBitboardSet(~lo, ~hi); }
+	constexpr ChessWideBitboardSet operator&(const ChessWideBitboardSet &that) const { return ChessWideBitboardSet(lo & that.lo, hi & that.hi); }
+	constexpr ChessWideBitboardSet operator|(const ChessWideBitboardSet &that) const { return ChessWideBitboardSet(lo | that.lo, hi | that.hi); }
+	constexpr ChessWideBitboardSet operator^(const ChessWideBitboardSet &that) const { return ChessWideBitboardSet(lo ^ that.lo, hi ^ that.hi); }
+	ChessWideBitboardSet& operator&=(const ChessWideBitboardSet &that) { lo &= that.lo; hi &= that.hi; return *this; }
+	ChessWideBitboardSet& operator|=(const ChessWideBitboardSet &that) { lo |= that.lo; hi |= that.hi; return *this; }
+	ChessWideBitboardSet& operator^=(const ChessWideBitboardSet &that) { lo ^= that.lo; hi ^= that.hi; return *this; }
+
+	constexpr ChessWideBitboardSet operator<<(unsigned n) const
+	{
+		return
+			n==0 ? *this :
+			n>=128 ? ChessWideBitboardSet() :
+			n>=64 ? ChessWideBitboardSet(0, lo << (n-64)) :
+			ChessWideBitboardSet(lo << n, (hi << n) | (lo >> (64-n)));
+	}
+	constexpr ChessWideBitboardSet operator>>(unsigned n) const
+	{
+		return
+			n==0 ? *this :
+			n>=128 ? ChessWideBitboardSet() :
+			n>=64 ? ChessWideBitboardSet(hi >> (n-64), 0) :
+			ChessWideBitboardSet((lo >> n) | (hi << (64-n)), hi >> n);
+	}
+};
+
+inline int bitCount(const uint64_t &s)
+{
+#ifdef _MSC_VER
+	return (int)__popcnt64(s);
+#else
+	return __builtin_popcountll(s);
+#endif
+}
+inline ChessGameParameters::BoardPosition_t bitScanForward(const uint64_t &s) // s must not be empty
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, s);
+	return (ChessGameParameters::BoardPosition_t)index;
+#else
+	return (ChessGameParameters::BoardPosition_t)__builtin_ctzll(s);
+#endif
+}
+inline ChessGameParameters::BoardPosition_t bitScanReverse(const uint64_t &s) // s must not be empty
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, s);
+	return (ChessGameParameters::BoardPosition_t)index;
+#else
+	return (ChessGameParameters::BoardPosition_t)(63 - __builtin_clzll(s));
+#endif
+}
+inline ChessGameParameters::BoardPosition_t popFirstBit(uint64_t &s) // s must not be empty
+{
+	auto pos = bitScanForward(s);
+	s &= s - 1;
+	return pos;
+}
+
+inline int bitCount(const ChessWideBitboardSet &s)
+{
+	return bitCount(s.lo) + bitCount(s.hi);
+}
+inline ChessGameParameters::BoardPosition_t bitScanForward(const ChessWideBitboardSet &s) // s must not be empty
+{
+	return s.lo ? bitScanForward(s.lo) : 64 + bitScanForward(s.hi);
+}
+inline ChessGameParameters::BoardPosition_t bitScanReverse(const ChessWideBitboardSet &s) // s must not be empty
+{
+	return s.hi ? 64 + bitScanReverse(s.hi) : bitScanReverse(s.lo);
+}
+inline ChessGameParameters::BoardPosition_t popFirstBit(ChessWideBitboardSet &s) // s must not be empty
+{
+	return s.lo ? popFirstBit(s.lo) : 64 + popFirstBit(s.hi);
+}
+
+template<typename Set>
+constexpr Set bitAt(const ChessGameParameters::BoardPosition_t &pos)
+{
+	return Set(1) << pos;
+}
+
+template<typename Set>
+class ChessBitboardBase
+{
+public:
+	typedef Set Set_t;
+	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+
+	static const BoardPosition_t MAX_CELL_COUNT = sizeof(Set_t)*8;
+
+	static bool isSupported(const ChessGameParameters &param);
+	static void init(const ChessGameParameters &param); // build the tables for the board geometry
+
+	static Set_t lowCells(BoardPosition_t count); // cells [0, count)
+	static Set_t shift(const Set_t &s, int fileShift, int rankShift); // cells moved off the board are dropped
+private:
+	enum Direction
+	{
+		NORTH, SOUTH, WEST, EAST, // from rookMove
+		NORTH_EAST, SOUTH_EAST, NORTH_WEST, SOUTH_WEST, // from bishopMove
+		DIRECTION_COUNT
+	};
+
+	// the tables depend on the board geometry only, so are shared by all the boards
+	static BoardPosition_t width;
+	static Set_t boardCells;
+	static Set_t filesFrom[MAX_CELL_COUNT+1]; // [n] - cells with file >= n
+	static Set_t filesBelow[MAX_CELL_COUNT+1]; // [n] - cells with file < n
+
+	static Set_t rays[DIRECTION_COUNT][MAX_CELL_COUNT];
+	static bool rayGoesUp[DIRECTION_COUNT]; // true if the ray goes to the bigger positions
+	static Set_t knightAttacks[MAX_CELL_COUNT];
+	static Set_t kingAttacks[MAX_CELL_COUNT];
+	static Set_t pawnTake[2][MAX_CELL_COUNT]; // [colour][pos]
+	static Set_t pawnNoTake[2][MAX_CELL_COUNT]; // [colour][pos]
+
+	static Set_t walk(BoardPosition_t pos, const MoveTemplate &mt);
+
+	Set_t pieces[KNOWN_CHESS_PIECE_COUNT]; // [EMPTY_CELL] is the set of empty cells
+	Set_t colours[2]; // [toArrayPosition(colour)]
+	Set_t occupied;
+
+	Set_t rayAttacks(Direction dir, BoardPosition_t pos) const;
+public:
+	void clear(BoardPosition_t cellCount);
+	void placePiece(BoardPosition_t pos, ChessPiece oldPiece, ChessPiece newPiece);
+
+	Set_t getPieces(ChessPiece piece) const;
+	Set_t getColour(ChessPlayerColour colour) const;
+	Set_t getOccupied() const;
+	int count(ChessPiece piece) const;
+
+	Set_t rookAttacks(BoardPosition_t pos) const;
+	Set_t bishopAttacks(BoardPosition_t pos) const;
+
+	Set_t attacks(ChessPiece piece, BoardPosition_t pos) const; // cells the piece can take on, up to and including the blockers
+	Set_t quietMoves(ChessPiece piece, BoardPosition_t pos) const; // cells the piece can only move to (pawn forward)
+	bool isAttacked(BoardPosition_t pos, ChessPlayerColour by) const;
+};
+
+typedef ChessBitboardBase<ChessBitboardSet> ChessBitboard; // up to 64 cells (8x8)
+typedef ChessBitboardBase<ChessWideBitboardSet> ChessWideBitboard; // up to 128 cells (10x8 etc.)
+
+// the sliders of the 64 bit boards are looked up in the ChessMagic tables instead of following the rays
+template<> ChessBitboardSet ChessBitboard::rookAttacks(BoardPosition_t pos) const;
+template<> ChessBitboardSet ChessBitboard::bishopAttacks(BoardPosition_t pos) const;
+
+#endif
@@ -2,6 +2,9 @@
 #include "ChessBoardAnalysis.hpp"
 #include "ChessBoard.hpp"
 #include "ChessMove.hpp" // because it is not included in ChessBoard.hpp due to the circular dep
+#include "ChessCellArrayPool.hpp"
+#include "ChessFrameCache.hpp"
+#include "ChessPositionTable.hpp"
 
 #include <iostream>
 #include <cassert>
@@ -12,98 +15,451 @@
 
 // static data members
 
+const ChessGameParameters::BoardPosition_t ChessBoardChange::MAX_CELL_COUNT;
+
 ChessGameParameters ChessBoard::param;
 
-int ChessBoard::chessBoardCount = 0;
-int ChessBoard::chessBoardArrayCreateCount = 0;
-int ChessBoard::chessBoardArrayRecreateAttemptCount = 0;
-int ChessBoard::chessBoardArrayDeleteCount = 0;
+std::atomic<int> ChessBoard::chessBoardCount(0);
+std::atomic<int> ChessBoard::chessBoardArrayCreateCount(0);
+std::atomic<int> ChessBoard::chessBoardArrayRecreateAttemptCount(0);
+std::atomic<int> ChessBoard::chessBoardArrayDeleteCount(0);
+
+uint16_t ChessBoard::keyframeInterval = 4;
 
 // class functions
 
+ChessBoardExtra::ChessBoardExtra()
+	: board(nullptr),
+	  bitboard(nullptr), wideBitboard(nullptr), paddedMailbox(nullptr), pieceList(nullptr),
+	  analysis(nullptr),
+	  lruPrev(ChessBoardSlab::NULL_INDEX), lruNext(ChessBoardSlab::NULL_INDEX),
+	  footprint(0), pins(0)
+{}
+
+void* ChessBoardExtra::operator new(size_t size, ChessBoardSlab &slab)
+{
+	return slab.allocate(size);
+}
+
+void ChessBoardExtra::operator delete(void* p, ChessBoardSlab &)
+{
+	ChessBoardSlab::deallocate(p);
+}
+
+void ChessBoardExtra::operator delete(void* p)
+{
+	ChessBoardSlab::deallocate(p);
+}
+
 ChessBoard::ChessBoard()
-	: board(new ChessPiece[param.cellCount]),
-	  enPassan(param.cellCount),
-	  moveNum(0), turn(ChessPlayerColour::WHITE),
-	  analysis(nullptr)
+	: hash(0),
+	  from(ChessBoardSlab::NULL_INDEX), extra(ChessBoardSlab::NULL_INDEX),
+	  refCount(0),
+	  moveNum(0)
 {
-	++chessBoardCount;
+	assert(param.cellCount <= ChessBoardChange::MAX_CELL_COUNT);
+	chessBoardCount.fetch_add(1, std::memory_order_relaxed);
 	
-	std::fill(board, board+param.cellCount, EMPTY_CELL);
+	ChessBoardExtra* e = makeExtra();
+	e->board = ChessCellArrayPool::allocate(param.cellCount);
+	std::fill(e->board, e->board+param.cellCount, EMPTY_CELL);
+	if(param.representation==ChessBoardRepresentation::BITBOARD)
+	{
+		e->bitboard = new ChessBitboard;
+		e->bitboard->clear(param.cellCount);
+	}
+	else if(param.representation==ChessBoardRepresentation::WIDE_BITBOARD)
+	{
+		e->wideBitboard = new ChessWideBitboard;
+		e->wideBitboard->clear(param.cellCount);
+	}
+	else if(param.representation==ChessBoardRepresentation::PADDED_MAILBOX)
+	{
+		e->paddedMailbox = new ChessPaddedMailbox;
+	}
+	if(!e->bitboard && !e->wideBitboard)
+	{
+		e->pieceList = new ChessPieceList(param.cellCount);
+	}
 	std::fill(changes, changes+4, ChessBoardChange(param.cellCount, EMPTY_CELL));
-	std::fill(whiteKingPos, whiteKingPos+3, param.cellCount);
-	std::fill(blackKingPos, blackKingPos+3, param.cellCount);
 	
-	whiteCastling[0] = whiteCastling[1] = blackCastling[0] = blackCastling[1] = param.cellCount;
+	state.whiteKingPos = state.blackKingPos = param.cellCount;
+	state.castling = 0;
+	state.enPassan = 0;
+	state.turn = toArrayPosition(ChessPlayerColour::WHITE);
+	state.tabled = 0;
 }
 ChessBoard::ChessBoard(const ChessBoard::ptr& that)
-	: board(nullptr),
-	  enPassan(param.cellCount),
-	  moveNum(that->moveNum), turn(that->turn),
-	  from(that),
-	  analysis(nullptr)
+	: hash(that->hash ^ ChessZobrist::enPassan(that->getEnPassan())), // en passan is for one move only
+	  from(ChessBoardSlab::toIndex(that.get())), extra(ChessBoardSlab::NULL_INDEX),
+	  state(that->state),
+	  refCount(0),
+	  moveNum(that->moveNum)
 {
-	++chessBoardCount;
+	chessBoardCount.fetch_add(1, std::memory_order_relaxed);
 	
+	intrusivePtrAddRef(that.get());
 	std::fill(changes, changes+4, ChessBoardChange(param.cellCount, EMPTY_CELL));
-
-	//std::copy(that->whiteKingPos, that->whiteKingPos+3, this->whiteKingPos);
-	//std::copy(that->blackKingPos, that->blackKingPos+3, this->blackKingPos);
-	whiteKingPos[0] = that->whiteKingPos[0];
-	whiteKingPos[1] = that->whiteKingPos[1];
-	whiteKingPos[2] = that->whiteKingPos[2];
-	blackKingPos[0] = that->blackKingPos[0];
-	blackKingPos[1] = that->blackKingPos[1];
-	blackKingPos[2] = that->blackKingPos[2];
-
-	std::copy(that->whiteCastling, that->whiteCastling+2, this->whiteCastling);
-	std::copy(that->blackCastling, that->blackCastling+2, this->blackCastling);
+	state.enPassan = 0;
+	state.tabled = 0;
 }
 
 ChessBoard::~ChessBoard()
 {
-	--chessBoardCount;
+	chessBoardCount.fetch_sub(1, std::memory_order_relaxed);
 	
-	if(board)
+	if(state.tabled)
+	{
+		if(ChessPositionTable* table = positionTable())
+		{
+			table->remove(this);
+		}
+	}
+	releaseCells();
+	ChessBoardExtra* e = getExtra();
+	if(e)
+	{
+		if(ChessFrameCache* cache = frameCache())
+		{
+			cache->remove(this);
+		}
+		if(e->analysis)
+		{
+			delete e->analysis;
+		}
+		delete e;
+	}
+	resetFrom();
+}
+
+void* ChessBoard::operator new(size_t size)
+{
+	return ChessBoardSlab::current().allocateBoard(size);
+}
+
+void ChessBoard::operator delete(void* p)
+{
+	ChessBoardSlab::deallocateBoard(p);
+}
+
+ChessBoardExtra* ChessBoard::makeExtra()
+{
+	if(extra==ChessBoardSlab::NULL_INDEX)
+	{
+		extra = ChessBoardSlab::toIndex(new(ChessBoardSlab::of(this)) ChessBoardExtra);
+	}
+	return getExtra();
+}
+
+void ChessBoard::releaseExtra()
+{
+	ChessBoardExtra* e = getExtra();
+	if(e && !e->board && !e->analysis && !e->pins)
+	{
+		if(ChessFrameCache* cache = frameCache())
+		{
+			cache->remove(this);
+		}
+		delete e;
+		extra = ChessBoardSlab::NULL_INDEX;
+	}
+}
+
+void ChessBoard::resetFrom()
+{
+	ChessBoard* f = getFromBoard();
+	if(f)
 	{
-		delete[] board;
+		from = ChessBoardSlab::NULL_INDEX;
+		intrusivePtrRelease(f);
 	}
-	if(analysis)
+}
+
+void ChessBoard::setTurn(ChessPlayerColour colour)
+{
+	if(getTurn()!=colour)
 	{
-		delete analysis;
+		hash ^= ChessZobrist::blackToMove();
+	}
+	state.turn = toArrayPosition(colour);
+}
+
+void ChessBoard::setKingPos(ChessPlayerColour colour, BoardPosition_t pos)
+{
+	if(colour==ChessPlayerColour::WHITE)
+	{
+		state.whiteKingPos = pos;
+	}
+	else
+	{
+		state.blackKingPos = pos;
 	}
 }
 
 void ChessBoard::makeIFrame()
 {
-	if(!board)
+	if(!cells())
 	{
-		++chessBoardArrayCreateCount;
-		board = new ChessPiece[param.cellCount];
-		std::copy(from->board, from->board+param.cellCount, board);
-		for(size_t i=0; i<4; ++i)
+		chessBoardArrayCreateCount.fetch_add(1, std::memory_order_relaxed);
+		
+		// the nearest rolled out ancestor, the root at worst
+		const ChessBoard* keyframe = getFromBoard();
+		while(!keyframe->cells())
 		{
-			if(changes[i].pos==param.cellCount)
-			{
-				break;
-			}
-			board[changes[i].pos] = changes[i].piece;
+			keyframe = keyframe->getFromBoard();
+			assert(keyframe!=nullptr);
+		}
+		
+		const ChessBoardExtra* fe = keyframe->getExtra();
+		ChessBoardExtra* e = makeExtra();
+		e->board = ChessCellArrayPool::allocate(param.cellCount);
+		std::copy(fe->board, fe->board+param.cellCount, e->board);
+		if(fe->bitboard)
+		{
+			e->bitboard = new ChessBitboard(*fe->bitboard);
+		}
+		if(fe->wideBitboard)
+		{
+			e->wideBitboard = new ChessWideBitboard(*fe->wideBitboard);
+		}
+		if(fe->paddedMailbox)
+		{
+			e->paddedMailbox = new ChessPaddedMailbox(*fe->paddedMailbox);
+		}
+		if(fe->pieceList)
+		{
+			e->pieceList = new ChessPieceList(*fe->pieceList);
 		}
+		replayChanges(*this, keyframe);
+		assert(isHashValid());
 	}
 	else
 	{
-		++chessBoardArrayRecreateAttemptCount;
+		chessBoardArrayRecreateAttemptCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	if(ChessFrameCache* cache = frameCache())
+	{
+		cache->touch(this);
 	}
 }
 
+void ChessBoard::replayChanges(const ChessBoard &board, const ChessBoard* keyframe)
+{
+	// the oldest first
+	const ChessBoard* f = board.getFromBoard();
+	if(f!=keyframe)
+	{
+		replayChanges(*f, keyframe);
+	}
+	for(size_t i=0; i<4; ++i)
+	{
+		if(board.changes[i].pos==param.cellCount)
+		{
+			break;
+		}
+		setCell(board.changes[i].pos, (ChessPiece)board.changes[i].piece);
+	}
+}
+
+bool ChessBoard::isKeyframe() const
+{
+	return !getFromBoard() || moveNum % keyframeInterval == 0;
+}
+
 void ChessBoard::makePFrame()
 {
-	if(board)
+	if(getFromBoard()) // nothing to rebuild a root from
+	{
+		releaseCells();
+	}
+}
+
+void ChessBoard::releaseCells()
+{
+	ChessBoardExtra* e = getExtra();
+	if(!e)
+	{
+		return;
+	}
+	if(e->board)
+	{
+		chessBoardArrayDeleteCount.fetch_add(1, std::memory_order_relaxed);
+		ChessCellArrayPool::deallocate(e->board, param.cellCount);
+		e->board=nullptr;
+	}
+	if(e->bitboard)
+	{
+		delete e->bitboard;
+		e->bitboard=nullptr;
+	}
+	if(e->wideBitboard)
+	{
+		delete e->wideBitboard;
+		e->wideBitboard=nullptr;
+	}
+	if(e->paddedMailbox)
+	{
+		delete e->paddedMailbox;
+		e->paddedMailbox=nullptr;
+	}
+	if(e->pieceList)
+	{
+		delete e->pieceList;
+		e->pieceList=nullptr;
+	}
+	releaseExtra();
+	if(getExtra())
+	{
+		if(ChessFrameCache* cache = frameCache())
+		{
+			cache->recount(this);
+		}
+	}
+}
+
+ChessFrameCache* ChessBoard::frameCache() const
+{
+	return ChessBoardSlab::of(this).getFrameCache();
+}
+
+ChessPositionTable* ChessBoard::positionTable() const
+{
+	return ChessBoardSlab::of(this).getPositionTable();
+}
+
+size_t ChessBoard::getFootprint() const
+{
+	const ChessBoardExtra* e = getExtra();
+	if(!e)
+	{
+		return 0;
+	}
+	size_t result = ChessBoardSlab::RECORD_SIZE;
+	if(e->board)
+	{
+		result += param.cellCount*sizeof(ChessPiece);
+	}
+	if(e->bitboard)
+	{
+		result += sizeof(ChessBitboard);
+	}
+	if(e->wideBitboard)
+	{
+		result += sizeof(ChessWideBitboard);
+	}
+	if(e->paddedMailbox)
+	{
+		result += sizeof(ChessPaddedMailbox);
+	}
+	if(e->pieceList)
+	{
+		result += e->pieceList->getFootprint();
+	}
+	if(e->analysis)
+	{
+		result += ChessBoardSlab::RECORD_SIZE + e->analysis->getFootprint();
+	}
+	return result;
+}
+
+void ChessBoard::setCell(const BoardPosition_t &pos, ChessPiece piece)
+{
+	ChessBoardExtra* e = getExtra();
+	assert(e!=nullptr && e->board!=nullptr);
+	if(e->bitboard)
+	{
+		e->bitboard->placePiece(pos, e->board[pos], piece);
+	}
+	else if(e->wideBitboard)
+	{
+		e->wideBitboard->placePiece(pos, e->board[pos], piece);
+	}
+	else if(e->paddedMailbox)
+	{
+		e->paddedMailbox->placePiece(pos, piece);
+	}
+	if(e->pieceList)
+	{
+		e->pieceList->placePiece(pos, e->board[pos], piece);
+	}
+	e->board[pos] = piece;
+}
+
+ChessPiece ChessBoard::getPieceBeforeChange(const BoardPosition_t &pos) const
+{
+	// the latest change of the cell, if any, up to the nearest rolled out board
+	for(const ChessBoard* b = this; ; b = b->getFromBoard())
+	{
+		const ChessPiece* board = b->cells();
+		if(board)
+		{
+			return board[pos];
+		}
+		for(size_t i=4; i>0; --i)
+		{
+			if(b->changes[i-1].pos==pos)
+			{
+				return (ChessPiece)b->changes[i-1].piece;
+			}
+		}
+	}
+}
+
+ChessBoard::BoardPosition_t ChessBoard::getEnPassan() const
+{
+	return state.enPassan ? (changes[0].pos + changes[1].pos) / 2 : param.cellCount;
+}
+
+void ChessBoard::setEnPassan(const BoardPosition_t &pos)
+{
+	assert(pos==param.cellCount || pos==(changes[0].pos + changes[1].pos) / 2);
+	hash ^= ChessZobrist::enPassan(getEnPassan()) ^ ChessZobrist::enPassan(pos);
+	state.enPassan = pos!=param.cellCount;
+}
+
+ChessBoard::BoardPosition_t ChessBoard::getCastling(ChessPlayerColour colour, size_t side) const
+{
+	const size_t bit = toArrayPosition(colour)*2 + side;
+	return (state.castling >> bit) & 1 ? param.castling[toArrayPosition(colour)][side] : param.cellCount;
+}
+
+void ChessBoard::disallowCastling(ChessPlayerColour colour, size_t side)
+{
+	hash ^= ChessZobrist::castling(colour, getCastling(colour, side)) ^ ChessZobrist::castling(colour, param.cellCount);
+	state.castling &= ~(1u << (toArrayPosition(colour)*2 + side));
+}
+
+ChessBoard::Hash_t ChessBoard::calculateHash() const
+{
+	const ChessPiece* board = cells();
+	assert(board!=nullptr);
+	
+	Hash_t result = 0;
+	for(BoardPosition_t pos=0; pos<param.cellCount; ++pos)
+	{
+		result ^= ChessZobrist::piece(board[pos], pos);
+	}
+	if(getTurn()==ChessPlayerColour::BLACK)
+	{
+		result ^= ChessZobrist::blackToMove();
+	}
+	for(size_t i=0; i<2; ++i)
 	{
-		++chessBoardArrayDeleteCount;
-		delete[] board;
-		board=nullptr;
+		result ^= ChessZobrist::castling(ChessPlayerColour::WHITE, getCastling(ChessPlayerColour::WHITE, i));
+		result ^= ChessZobrist::castling(ChessPlayerColour::BLACK, getCastling(ChessPlayerColour::BLACK, i));
 	}
+	result ^= ChessZobrist::enPassan(getEnPassan());
+	return result;
+}
+
+ChessBoard::Hash_t ChessBoard::getHash() const
+{
+	return hash;
+}
+
+bool ChessBoard::isHashValid() const
+{
+	return hash==calculateHash();
 }
 
 ChessBoard::BoardPosition_t ChessBoard::getPos(const BoardPosition_t &file, const BoardPosition_t &rank) const
@@ -116,7 +472,7 @@ std::string ChessBoard::toFEN() const
 	std::string result;
 	
 	int countEmpty=0;
-	ChessPiece* c=board;
+	ChessPiece* c=cells();
 	for(int rank=7; rank>=0; --rank)
 	{
 		for(int file=0; file<8; ++file)
@@ -151,7 +507,7 @@ std::string ChessBoard::toFEN() const
 	
 	result += ' ';
 	
-	result += turn==ChessPlayerColour::WHITE ? 'w' : 'b';
+	result += getTurn()==ChessPlayerColour::WHITE ? 'w' : 'b';
 	
 	result += ' ';
 	
@@ -160,7 +516,9 @@ std::string ChessBoard::toFEN() const
 
 void ChessBoard::debugPrint() const
 {
-	if(turn==ChessPlayerColour::WHITE)
+	const ChessPiece* board = cells();
+	const BoardPosition_t enPassan = getEnPassan();
+	if(getTurn()==ChessPlayerColour::WHITE)
 	{
 		std::cout << "White's turn" << std::endl;
 	}
@@ -194,16 +552,15 @@ void ChessBoard::debugPrint() const
 			std::cout << std::endl;
 		}
 	}
+	// the P-frames cost only the node, the I-frames and the analysed boards also the ChessBoardExtra record
+	std::cout << chessBoardCount << " boards, " << sizeof(ChessBoard) << " bytes per board, "
+		<< ChessBoardSlab::RECORD_SIZE << " more per I-frame (and "
+		<< param.cellCount*sizeof(ChessPiece) << " for its cells)" << std::endl;
 }
 
 ChessBoard::ptr ChessBoard::getFrom() const
 {
-	return from;
-}
-
-ChessPlayerColour ChessBoard::getTurn() const
-{
-	return turn;
+	return getFromBoard();
 }
 
 void ChessBoard::placePiece(const char &file, int const &rank, ChessPiece piece)
@@ -218,9 +575,10 @@ void ChessBoard::placePiecePos(const BoardPosition_t &file, const BoardPosition_
 }
 void ChessBoard::placePiecePos(const BoardPosition_t &pos, ChessPiece piece)
 {
-	if(board)
+	hash ^= ChessZobrist::piece(getPieceBeforeChange(pos), pos) ^ ChessZobrist::piece(piece, pos);
+	if(cells())
 	{
-		board[pos] = std::move(piece);
+		setCell(pos, piece);
 	}
 	for(size_t i=0; i<4; ++i)
 	{
@@ -243,12 +601,6 @@ ChessPiece ChessBoard::getPiecePos(const ChessBoard::BoardPosition_t &file, cons
 	//Log::info("getPiecePos called without pos");
 	return getPiecePos(getPos(file, rank));
 }
-ChessPiece ChessBoard::getPiecePos(const ChessBoard::BoardPosition_t &pos) const
-{
-	assert(board!=nullptr);
-	return board[pos];
-}
-
 uint16_t ChessBoard::getMoveNum() const
 {
 	return moveNum;
@@ -266,20 +618,30 @@ bool ChessBoard::isEmptyPos(const ChessBoard::BoardPosition_t &file, const Chess
 }
 bool ChessBoard::isEmptyPos(const ChessBoard::BoardPosition_t &pos) const
 {
-	return board[pos] == EMPTY_CELL;
+	return getPiecePos(pos) == EMPTY_CELL;
 }
 
 void ChessBoard::clearPossibleMoves(ChessBoard::ptr toKeep)
 {
-	if(!analysis) return;
-	analysis->clearPossibleMoves(toKeep);
+	ChessBoardExtra* e = getExtra();
+	if(!e || !e->analysis) return;
+	e->analysis->clearPossibleMoves(toKeep);
+	if(ChessFrameCache* cache = frameCache())
+	{
+		cache->recount(this);
+	}
 }
 
 ChessBoardAnalysis* ChessBoard::getAnalysis(ChessBoard::ptr& self)
 {
-	if(self->analysis==nullptr)
+	ChessBoardExtra* e = self->makeExtra();
+	if(e->analysis==nullptr)
+	{
+		e->analysis = new(ChessBoardSlab::of(self.get())) ChessBoardAnalysis(self);
+	}
+	if(ChessFrameCache* cache = self->frameCache())
 	{
-		self->analysis = new ChessBoardAnalysis(self);
+		cache->touch(self.get());
 	}
-	return self->analysis;
+	return e->analysis;
 }
\ No newline at end of file
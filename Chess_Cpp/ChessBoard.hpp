@@ -8,65 +8,147 @@
 #include <map>
 #include <memory>
 #include <cstdint>
+#include <cassert>
+#ifdef CHESS_ATOMIC_REFCOUNT
+#include <atomic>
+#endif
 
 #include "ChessBoardIterator.hpp"
 #include "ChessPiece.hpp"
 #include "ChessGameParameters.hpp"
+#include "ChessBitboard.hpp"
+#include "ChessPaddedMailbox.hpp"
+#include "ChessPieceList.hpp"
+#include "ChessZobrist.hpp"
+#include "ChessIntrusivePtr.hpp"
+#include "ChessBoardSlab.hpp"
 
 class ChessBoardAnalysis;
+class ChessFrameCache;
+class ChessPositionTable;
 
-struct ChessBoardChange
+struct ChessBoardChange // 16 bits
 {
-	ChessGameParameters::BoardPosition_t pos;
-	ChessPiece piece;
+	// pos==cellCount marks the unused change, so the boards are up to 2047 cells
+	static const ChessGameParameters::BoardPosition_t MAX_CELL_COUNT = (1 << 11) - 1;
 	
-	ChessBoardChange(ChessGameParameters::BoardPosition_t pos_=-1, ChessPiece piece_=EMPTY_CELL)
+	uint16_t pos : 11;
+	uint16_t piece : 5;
+	
+	ChessBoardChange(ChessGameParameters::BoardPosition_t pos_=MAX_CELL_COUNT, ChessPiece piece_=EMPTY_CELL)
 	:pos(pos_), piece(piece_)
 	{}
 };
 
 class ChessBoard;
 
+// what only the I-frames and the analysed boards need, kept out of ChessBoard to make the P-frames small
+struct ChessBoardExtra
+{
+	ChessPiece* board; // [rank*w+file]
+	ChessBitboard* bitboard; // exists together with board for ChessBoardRepresentation::BITBOARD
+	ChessWideBitboard* wideBitboard; // exists together with board for ChessBoardRepresentation::WIDE_BITBOARD
+	ChessPaddedMailbox* paddedMailbox; // exists together with board for ChessBoardRepresentation::PADDED_MAILBOX
+	ChessPieceList* pieceList; // exists together with board for the representations without bitboards
+	ChessBoardAnalysis* analysis;
+	
+	ChessBoardSlab::Index_t lruPrev, lruNext; // ChessFrameCache list
+	uint32_t footprint; // bytes counted by ChessFrameCache, 0 while not in its list
+	uint16_t pins; // ChessFrameCache::Pin-s
+	
+	ChessBoardExtra();
+	
+	// lives in the ChessBoardSlab of its board
+	static void* operator new(size_t size, ChessBoardSlab &slab);
+	static void operator delete(void* p, ChessBoardSlab &slab);
+	static void operator delete(void* p);
+};
+
 class ChessBoard
 {
 public:
-	typedef std::shared_ptr<ChessBoard> ptr;
-	typedef std::weak_ptr<ChessBoard> wptr;
+	typedef ChessIntrusivePtr<ChessBoard> ptr;
+#ifdef CHESS_ATOMIC_REFCOUNT
+	typedef std::atomic<uint16_t> RefCount_t;
+#else
+	typedef uint16_t RefCount_t; // a board is referred by its children, a few handles and the analysis of the parent
+#endif
 	
 	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+	typedef ChessZobrist::Hash_t Hash_t;
 
 	static ChessGameParameters param;
 		
-	static int chessBoardCount;
+	// the statistics, counted by every thread that makes boards (see ChessPerft), relaxed as nothing is ordered by them
+	static std::atomic<int> chessBoardCount;
+	
+	static std::atomic<int> chessBoardArrayCreateCount;
+	static std::atomic<int> chessBoardArrayRecreateAttemptCount;
+	static std::atomic<int> chessBoardArrayDeleteCount;
 	
-	static int chessBoardArrayCreateCount;
-	static int chessBoardArrayRecreateAttemptCount;
-	static int chessBoardArrayDeleteCount;
+	// the plies (counted from the root position) kept rolled out during the search, every keyframeInterval-th;
+	// the boards between them are rebuilt from the nearest keyframe above, so a bigger interval saves memory
+	// for the cost of replaying more changes. 1 keeps every searched board an I-frame
+	static uint16_t keyframeInterval;
+	
+	// the kings, the castling rights, the en passan flag and the turn, in 32 bits
+	struct State
+	{
+		uint32_t whiteKingPos : 11;
+		uint32_t blackKingPos : 11;
+		uint32_t castling : 4; // bit per ChessGameParameters::castling cell, set while the castling is allowed
+		uint32_t enPassan : 1; // the first two changes are a pawn's double step, over the en passan cell
+		uint32_t turn : 1; // ChessPlayerColour
+		uint32_t tabled : 1; // in the ChessPositionTable of its slab
+	};
 private:
+	// 32 bytes, the retained tree is millions of these
 	ChessBoardChange changes[4]; // maximum 4 changes allowed
-	ChessPiece* board; // [rank*w+file]
-
-	BoardPosition_t enPassan;
-	BoardPosition_t whiteKingPos[3]; // position, file, rank
-	BoardPosition_t blackKingPos[3]; // position, file, rank
-	BoardPosition_t whiteCastling[2];
-	BoardPosition_t blackCastling[2];
-	
+	Hash_t hash; // kept up to date by placePiecePos, setEnPassan and disallowCastling
+	ChessBoardSlab::Index_t from; // counted reference to the previous board
+	ChessBoardSlab::Index_t extra; // ChessBoardExtra, for the I-frames and the analysed boards only
+	State state;
+	RefCount_t refCount; // the number of ChessBoard::ptr-s to this board
 	uint16_t moveNum;
-	ChessPlayerColour turn;
-	
-	ChessBoard::ptr from;
-	
-	ChessBoardAnalysis* analysis;
 
 	ChessBoard();
 	ChessBoard(const ChessBoard& that) = delete;
 	ChessBoard(const ptr& that);
+	
+	ChessBoardExtra* getExtra() const; // nullptr for the P-frames without analysis
+	ChessBoardExtra* makeExtra();
+	void releaseExtra(); // if nothing is left in it
+	void releaseCells(); // makePFrame, for the roots too
+	ChessFrameCache* frameCache() const; // of the slab of this board, nullptr if none
+	ChessPositionTable* positionTable() const; // of the slab of this board, nullptr if none
+	ChessBoard* getFromBoard() const; // not counted
+	void resetFrom();
+	
+	ChessPiece* cells() const; // nullptr for the P-frames
+	ChessBitboard* bitboard() const;
+	ChessWideBitboard* wideBitboard() const;
+	ChessPaddedMailbox* paddedMailbox() const;
+	ChessPieceList* pieceList() const;
+	
+	void setTurn(ChessPlayerColour colour);
+	void setKingPos(ChessPlayerColour colour, BoardPosition_t pos);
+	
+	void setCell(const BoardPosition_t &pos, ChessPiece piece); // changes the I-frame without recording the change
+	void replayChanges(const ChessBoard &board, const ChessBoard* keyframe); // of board and its ancestors below keyframe
+	ChessPiece getPieceBeforeChange(const BoardPosition_t &pos) const; // works for the P-frames too
+	void setEnPassan(const BoardPosition_t &pos); // pos is the cell between the first two changes
+	void disallowCastling(ChessPlayerColour colour, size_t side);
+	Hash_t calculateHash() const; // from scratch, for the I-frames
 public:
 	~ChessBoard();
 	
-	void makeIFrame(); // roll out, making easier to process
-	void makePFrame(); // release the memory keeping only the differences
+	// the boards live in the ChessBoardSlab of the search that has made them
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+	
+	void makeIFrame(); // roll out, making easier to process, from the nearest rolled out ancestor
+	void makePFrame(); // release the memory keeping only the differences (the root boards stay rolled out)
+	bool isKeyframe() const; // to be kept rolled out, see keyframeInterval
 	
 	bool isEmpty(const char &file, const int &rank) const;
 	bool isEmptyPos(const BoardPosition_t &file, const BoardPosition_t &rank) const;
@@ -80,6 +162,12 @@ public:
 	ptr getFrom() const;
 	ChessPlayerColour getTurn() const;
 	uint16_t getMoveNum() const;
+	BoardPosition_t getKingPos(ChessPlayerColour colour) const;
+	BoardPosition_t getCastling(ChessPlayerColour colour, size_t side) const; // the rook, cellCount if not allowed
+	BoardPosition_t getEnPassan() const; // cellCount if none
+	Hash_t getHash() const;
+	size_t getFootprint() const; // the bytes rolled out: the cells, the bitboards and the analysis
+	bool isHashValid() const; // compare the incremental hash with the one calculated from scratch (debug check)
 	
 	BoardPosition_t getPos(const BoardPosition_t &file, const BoardPosition_t &rank) const;
 
@@ -101,6 +189,79 @@ public:
 	friend class ChessBoardConstIterator;
 	friend class ChessMove;
 	friend class ChessBoardAnalysis;
+	friend class ChessFrameCache;
+	friend class ChessPositionCodec;
+	friend class ChessPositionTable;
+	friend void intrusivePtrAddRef(ChessBoard* cb);
+	friend void intrusivePtrRelease(ChessBoard* cb);
 };
 
+static_assert(sizeof(ChessBoard) <= 32, "the P-frames must stay small");
+
+inline ChessBoardExtra* ChessBoard::getExtra() const
+{
+	return static_cast<ChessBoardExtra*>(ChessBoardSlab::fromIndex(extra));
+}
+inline ChessBoard* ChessBoard::getFromBoard() const
+{
+	return static_cast<ChessBoard*>(ChessBoardSlab::fromIndex(from));
+}
+inline ChessPiece* ChessBoard::cells() const
+{
+	auto e = getExtra();
+	return e ? e->board : nullptr;
+}
+inline ChessBitboard* ChessBoard::bitboard() const
+{
+	auto e = getExtra();
+	return e ? e->bitboard : nullptr;
+}
+inline ChessWideBitboard* ChessBoard::wideBitboard() const
+{
+	auto e = getExtra();
+	return e ? e->wideBitboard : nullptr;
+}
+inline ChessPaddedMailbox* ChessBoard::paddedMailbox() const
+{
+	auto e = getExtra();
+	return e ? e->paddedMailbox : nullptr;
+}
+inline ChessPieceList* ChessBoard::pieceList() const
+{
+	auto e = getExtra();
+	return e ? e->pieceList : nullptr;
+}
+inline ChessPlayerColour ChessBoard::getTurn() const
+{
+	return state.turn ? ChessPlayerColour::BLACK : ChessPlayerColour::WHITE;
+}
+inline ChessBoard::BoardPosition_t ChessBoard::getKingPos(ChessPlayerColour colour) const
+{
+	return colour==ChessPlayerColour::WHITE ? state.whiteKingPos : state.blackKingPos;
+}
+inline ChessPiece ChessBoard::getPiecePos(const ChessBoard::BoardPosition_t &pos) const
+{
+	ChessPiece* board = cells();
+	assert(board!=nullptr);
+	return board[pos];
+}
+
+inline void intrusivePtrAddRef(ChessBoard* cb)
+{
+	++cb->refCount;
+}
+inline void intrusivePtrRelease(ChessBoard* cb)
+{
+	// the boards of a frozen slab are destroyed by ChessBoardSlab::release all at once, in no order,
+	// so their counts are not kept any more: cb may be one destroyed already
+	if(ChessBoardSlab::of(cb).isFrozen())
+	{
+		return;
+	}
+	if(--cb->refCount==0)
+	{
+		delete cb;
+	}
+}
+
 #endif
\ No newline at end of file
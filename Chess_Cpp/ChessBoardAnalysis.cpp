@@ -1,6 +1,9 @@
 #include "ChessBoardAnalysis.hpp"
 #include "ChessBoardIterator.hpp"
 #include "ChessPlayerColour.hpp"
+#include "ChessBoardGeometry.hpp"
+#include "ChessFrameCache.hpp"
+#include "ChessPositionTable.hpp"
 #include <cassert>
 #include <algorithm>
 
@@ -16,13 +19,50 @@ ChessBoardFactory ChessBoardAnalysis::factory;
 
 // helper
 
-inline constexpr weight_type domination(const int8_t &white, const int8_t &black)
+inline ChessAttackMap::Word_t wordOf(const uint64_t &set, size_t) // of a bitboard set, as the attack maps have it
+{
+	return set;
+}
+inline ChessAttackMap::Word_t wordOf(const ChessWideBitboardSet &set, size_t word)
+{
+	return word ? set.hi : set.lo;
+}
+constexpr weight_type victimWeight(const ChessPiece &cp) // the captures are ordered by it and by the attacker, the fairy pieces too
+{
+	return
+		cp==PAWN_WHITE     || cp==PAWN_BLACK     ? 1 :
+		cp==KNIGHT_WHITE   || cp==KNIGHT_BLACK   ? 3 :
+		cp==BISHOP_WHITE   || cp==BISHOP_BLACK   ? 3 :
+		cp==ROOK_WHITE     || cp==ROOK_BLACK     ? 5 :
+		cp==PRINCESS_WHITE || cp==PRINCESS_BLACK ? 6 :
+		cp==QUEEN_WHITE    || cp==QUEEN_BLACK    ? 7 :
+		cp==EMPRESS_WHITE  || cp==EMPRESS_BLACK  ? 8 :
+		cp==AMAZON_WHITE   || cp==AMAZON_BLACK   ? 10 :
+		0;
+}
+
+// the lines from the other king a piece may check along, the cells on them are found once per node
+enum CheckLine : uint8_t
+{
+	ROOK_LINE = 1,
+	BISHOP_LINE = 2,
+	KNIGHT_LINE = 4,
+	PAWN_LINE = 8
+};
+constexpr uint8_t checkLines(const ChessPiece &cp)
 {
 	return
-		white==black ? 0 :
-		white>black ? 1 :
-		-1;
+		cp==PAWN_WHITE     || cp==PAWN_BLACK     ? PAWN_LINE :
+		cp==KNIGHT_WHITE   || cp==KNIGHT_BLACK   ? KNIGHT_LINE :
+		cp==BISHOP_WHITE   || cp==BISHOP_BLACK   ? BISHOP_LINE :
+		cp==ROOK_WHITE     || cp==ROOK_BLACK     ? ROOK_LINE :
+		cp==PRINCESS_WHITE || cp==PRINCESS_BLACK ? BISHOP_LINE | KNIGHT_LINE :
+		cp==QUEEN_WHITE    || cp==QUEEN_BLACK    ? ROOK_LINE | BISHOP_LINE :
+		cp==EMPRESS_WHITE  || cp==EMPRESS_BLACK  ? ROOK_LINE | KNIGHT_LINE :
+		cp==AMAZON_WHITE   || cp==AMAZON_BLACK   ? ROOK_LINE | BISHOP_LINE | KNIGHT_LINE :
+		0;
 }
+
 constexpr weight_type weightFromPiece(const ChessPiece &cp)
 {
 	return 
@@ -34,20 +74,54 @@ constexpr weight_type weightFromPiece(const ChessPiece &cp)
 		cp==KING_WHITE   || cp==KING_BLACK   ? BOARD_KING_WEIGHT :
 		0;
 }
+static const uint8_t CENTRE_CELL_WEIGHT[64] // other board sizes are stretched to 8x8
+{
+	3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3,
+	2, 2, 7, 7, 7, 7, 2, 2,
+	1, 4, 6, 8, 8, 6, 4, 1,
+	1, 4, 6, 8, 8, 6, 4, 1,
+	2, 2, 7, 7, 7, 7, 2, 2,
+	3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3
+};
 
 // static variables
 
-unsigned long long ChessBoardAnalysis::constructed=0;
+std::atomic<unsigned long long> ChessBoardAnalysis::constructed(0);
+const unsigned ChessBoardAnalysis::CENTRE_WEIGHT_BITS;
+const weight_type ChessBoardAnalysis::CAPTURE_SCORE;
+const weight_type ChessBoardAnalysis::PROMOTION_SCORE;
+const weight_type ChessBoardAnalysis::VICTIM_SCORE;
+const weight_type ChessBoardAnalysis::CHECK_SCORE;
+std::vector<ChessAttackMap::Word_t> ChessBoardAnalysis::centreWeights;
 
 
 // class functions
 
+void ChessBoardAnalysis::init(const ChessGameParameters &param)
+{
+	const size_t words = ChessAttackMap::getWordCount();
+	centreWeights.assign(CENTRE_WEIGHT_BITS*words, 0);
+	for(ChessBoard::BoardPosition_t pos=0; pos<param.cellCount; ++pos)
+	{
+		// on 8x8 it folds to pos
+		const auto cell = (pos/param.width*8/param.height)*8 + pos%param.width*8/param.width;
+		for(unsigned bit=0; bit<CENTRE_WEIGHT_BITS; ++bit)
+		{
+			if(CENTRE_CELL_WEIGHT[cell] & (1u << bit))
+			{
+				centreWeights[bit*words + ChessAttackMap::wordOf(pos)] |= ChessAttackMap::bitOf(pos);
+			}
+		}
+	}
+}
+
 ChessBoardAnalysis::ChessBoardAnalysis(ChessBoard::ptr board_)
-	: board(std::move(board_)), possibleMoves(nullptr), check(false),
-		underAttackByWhite(nullptr), underAttackByBlack(nullptr)
+	: board(board_.get()), possibleMoves(nullptr), pendingMoves(nullptr), pendingNext(0), pendingScored(0), check(false), quietsPending(false), enPassanTakes(0)
 {
 	assert(board!=nullptr);
-	++constructed;
+	constructed.fetch_add(1, std::memory_order_relaxed);
 }
 
 ChessBoardAnalysis::~ChessBoardAnalysis()
@@ -55,172 +129,520 @@ ChessBoardAnalysis::~ChessBoardAnalysis()
 	this->reset();
 }
 
+void* ChessBoardAnalysis::operator new(size_t size, ChessBoardSlab &slab)
+{
+	return slab.allocate(size);
+}
+
+void ChessBoardAnalysis::operator delete(void* p, ChessBoardSlab &)
+{
+	ChessBoardSlab::deallocate(p);
+}
+
+void ChessBoardAnalysis::operator delete(void* p)
+{
+	ChessBoardSlab::deallocate(p);
+}
+
 void ChessBoardAnalysis::reset()
 {
-	if(possibleMoves) delete possibleMoves;
-	if(underAttackByWhite) delete[] underAttackByWhite;
-	if(underAttackByBlack) delete[] underAttackByBlack;
+	if(possibleMoves)
+	{
+		// this board is one parent less of the shared ones
+		for(auto it=possibleMoves->begin(), end=possibleMoves->end(); it!=end; ++it)
+		{
+			if(!it->board)
+			{
+				continue;
+			}
+			if(ChessPositionTable* table = ChessPositionTable::of(it->board.get()))
+			{
+				table->removeParent(it->board.get());
+			}
+		}
+		delete possibleMoves;
+	}
+	if(pendingMoves) delete pendingMoves;
+	attackMap.release();
 	
 	possibleMoves = nullptr;
-	underAttackByWhite = underAttackByBlack = nullptr;
+	pendingMoves = nullptr;
+	pendingNext = 0;
+	pendingScored = 0;
+	quietsPending = false;
+	enPassanTakes = 0;
 }
 
-void ChessBoardAnalysis::calculatePossibleMoves_common()
+void ChessBoardAnalysis::calculateKingLines(KingLines &lines) const
 {
-	typedef ChessMove::ChessMoveRecordingFunction ChessMoveRecordingFunction;
-		// empty function
-	const static ChessMoveRecordingFunction emptyFunction =
-			[](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {};
-
+	const ChessPlayerColour turn = board->getTurn();
+	const bool white = (turn==ChessPlayerColour::WHITE);
+	lines.king = board->getKingPos(turn);
+	lines.checkers = 0;
+	lines.pinCount = 0;
 	
-		// take opponent's piece
-		// or
-		// attack empty space
-	ChessMoveRecordingFunction functionTake[2][2] = 
-	{
-		// white turn
+	// the first piece on a ray may check, an own one may be pinned by the second
+	auto walk = [&](const ChessRayTable &rays, bool sliding, ChessPiece p1, ChessPiece p2, ChessPiece p3, ChessPiece p4) {
+		for(auto ray = rays.firstRay(lines.king), rayEnd = rays.endRay(lines.king); ray != rayEnd; ++ray)
 		{
-			//white
-			[this](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {
-				assert(this->board->getTurn()==ChessPlayerColour::WHITE);
-				
-				auto nextBoard = ChessBoardAnalysis::factory.createBoard(this->board, pos, newPos);
-				
-				assert(nextBoard->getTurn()==ChessPlayerColour::BLACK);
-				
-				if(ChessMove::isMovePossible(nextBoard))
+			KingLines::Line *pinned = nullptr;
+			for(auto it = rays.begin(ray), end = rays.end(ray); it != end; ++it)
+			{
+				const ChessPiece piece = board->getPiecePos(*it);
+				if(piece==EMPTY_CELL)
 				{
-					this->possibleMoves->push_back(nextBoard);
+					continue;
 				}
-				else
+				if(piece==p1 || piece==p2 || piece==p3 || piece==p4)
 				{
-					nextBoard.reset();
+					if(pinned)
+					{
+						pinned->end = it+1;
+						++lines.pinCount;
+					}
+					else
+					{
+						lines.check = KingLines::Line{ *it, rays.begin(ray), it+1 };
+						++lines.checkers;
+					}
 				}
-			},
-			//black
-			[this](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {
-				//assert(maybeMove->getTurn()==ChessPlayerColour::BLACK);
-				
-				if(this->board->getPiecePos(newPos)==KING_WHITE)
+				else if(sliding && !pinned && getColour(piece)==turn)
 				{
-					check=true;
+					pinned = &lines.pins[lines.pinCount];
+					pinned->pos = *it;
+					pinned->begin = rays.begin(ray);
+					continue;
 				}
+				break;
 			}
-		},
-		// black turn
+		}
+	};
+	
+	// as in ChessMove::isKingSafe, the moves are symmetric but the pawns'
+	if(white)
+	{
+		walk(ChessRayTable::takeRays(ROOK_WHITE), true, ROOK_BLACK, QUEEN_BLACK, EMPRESS_BLACK, AMAZON_BLACK);
+		walk(ChessRayTable::takeRays(BISHOP_WHITE), true, BISHOP_BLACK, QUEEN_BLACK, PRINCESS_BLACK, AMAZON_BLACK);
+		walk(ChessRayTable::takeRays(KNIGHT_WHITE), false, KNIGHT_BLACK, PRINCESS_BLACK, EMPRESS_BLACK, AMAZON_BLACK);
+		walk(ChessRayTable::takeRays(PAWN_WHITE), false, PAWN_BLACK, PAWN_BLACK, PAWN_BLACK, PAWN_BLACK);
+	}
+	else
+	{
+		walk(ChessRayTable::takeRays(ROOK_WHITE), true, ROOK_WHITE, QUEEN_WHITE, EMPRESS_WHITE, AMAZON_WHITE);
+		walk(ChessRayTable::takeRays(BISHOP_WHITE), true, BISHOP_WHITE, QUEEN_WHITE, PRINCESS_WHITE, AMAZON_WHITE);
+		walk(ChessRayTable::takeRays(KNIGHT_WHITE), false, KNIGHT_WHITE, PRINCESS_WHITE, EMPRESS_WHITE, AMAZON_WHITE);
+		walk(ChessRayTable::takeRays(PAWN_BLACK), false, PAWN_WHITE, PAWN_WHITE, PAWN_WHITE, PAWN_WHITE);
+	}
+}
+
+bool ChessBoardAnalysis::deriveAttackMaps()
+{
+	const ChessBoard* parent = board->getFromBoard();
+	const ChessBoardExtra* parentExtra = parent ? parent->getExtra() : nullptr;
+	const ChessBoardAnalysis* from = parentExtra ? parentExtra->analysis : nullptr;
+	if(!from || !from->attackMap.isAllocated())
+	{
+		return false; // released, or the parent isn't analysed
+	}
+	
+	// both sides' attacks are in the map of the side to move, the parent's is in the other one
+	const ChessPlayerColour turn = board->getTurn();
+	attackMap.copy(turn, from->attackMap, !turn);
+	if(from->enPassanTakes)
+	{
+		const auto enPassan = parent->getEnPassan();
+		const auto taken = turn==ChessPlayerColour::WHITE ? enPassan + ChessBoard::param.width : enPassan - ChessBoard::param.width;
+		for(uint8_t i=0; i<from->enPassanTakes; ++i)
+		{
+			attackMap.decrement(turn, taken);
+		}
+	}
+	
+	// the changed cells, with their pieces on the parent
+	ChessBoard::BoardPosition_t changed[4];
+	ChessPiece before[4];
+	size_t changedCount = 0;
+	auto isChanged = [&](ChessBoard::BoardPosition_t pos) -> bool {
+		return std::find(changed, changed+changedCount, pos)!=changed+changedCount;
+	};
+	for(const auto &change : board->changes)
+	{
+		if(change.pos==ChessBoard::param.cellCount || isChanged(change.pos))
+		{
+			continue;
+		}
+		changed[changedCount] = change.pos;
+		before[changedCount++] = parent->getPieceBeforeChange(change.pos);
+	}
+	auto onParent = [&](ChessBoard::BoardPosition_t pos) -> ChessPiece {
+		for(size_t i=0; i<changedCount; ++i)
+		{
+			if(changed[i]==pos)
+			{
+				return before[i];
+			}
+		}
+		return board->getPiecePos(pos);
+	};
+	auto onBoard = [this](ChessBoard::BoardPosition_t pos) -> ChessPiece {
+		return board->getPiecePos(pos);
+	};
+	
+	// the cells of a walk go to the map as sets, a word at a time (a walk reaches a cell once at most)
+	size_t pendingWord = 0;
+	ChessAttackMap::Word_t added = 0, removed = 0;
+	auto flush = [&]() {
+		attackMap.add(turn, pendingWord, added);
+		attackMap.subtract(turn, pendingWord, removed);
+		added = removed = 0;
+	};
+	auto record = [&](ChessBoard::BoardPosition_t pos, bool more) {
+		const size_t word = ChessAttackMap::wordOf(pos);
+		if(word!=pendingWord)
 		{
-			// white
-			[this](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {
-				assert(this->board->getTurn()==ChessPlayerColour::BLACK);
-				if(this->board->getPiecePos(newPos)==KING_BLACK)
+			flush();
+			pendingWord = word;
+		}
+		(more ? added : removed) |= ChessAttackMap::bitOf(pos);
+	};
+	
+	// the cells a piece defends in the walk: up to and including the first piece of every ray
+	auto defends = [&](const auto &pieceAt, ChessBoard::BoardPosition_t pos, ChessPiece piece, int8_t count) {
+		auto pieceParam = moveParameters[piece];
+		const ChessRayTable &rays = pieceParam->isDifferentMoveTypes ? *pieceParam->takeRays : *pieceParam->anyRays;
+		for(auto ray = rays.firstRay(pos), rayEnd = rays.endRay(pos); ray != rayEnd; ++ray)
+		{
+			for(auto it = rays.begin(ray), end = rays.end(ray); it != end; ++it)
+			{
+				record(*it, count>0);
+				if(pieceAt(*it)!=EMPTY_CELL)
 				{
-					check=true;
+					break;
 				}
-			},
-			// black
-			[this](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {
-				assert(this->board->getTurn()==ChessPlayerColour::BLACK);
-
-				auto nextBoard = ChessBoardAnalysis::factory.createBoard(this->board, pos, newPos);
-				
-				assert(nextBoard->getTurn()==ChessPlayerColour::WHITE);
-				
-				if(ChessMove::isMovePossible(nextBoard))
+			}
+		}
+		flush();
+	};
+	
+	// the sliders looking at a changed cell on either board: only their ray through the cell is walked again.
+	// the changed cells are looked through, a slider stopped by one of them is found from that one as well
+	std::pair<ChessBoard::BoardPosition_t, ChessRayTable::Ray_t> sliderRays[4*8]; // a ray per line of a changed cell
+	size_t sliderRayCount = 0;
+	auto findSliders = [&](ChessBoard::BoardPosition_t pos, const ChessRayTable &rays,
+		ChessPiece p1, ChessPiece p2, ChessPiece p3, ChessPiece p4) {
+		for(auto ray = rays.firstRay(pos), rayEnd = rays.endRay(pos); ray != rayEnd; ++ray)
+		{
+			ChessBoard::BoardPosition_t towards = pos; // the cell next to the slider on its ray
+			for(auto it = rays.begin(ray), end = rays.end(ray); it != end; towards = *it++)
+			{
+				const ChessPiece piece = board->getPiecePos(*it);
+				if(piece==EMPTY_CELL || isChanged(*it))
 				{
-					this->possibleMoves->push_back(nextBoard);
+					continue;
 				}
-				else
+				const ChessPiece kind = (piece & 1) ? piece : piece-1; // white - odd
+				if(kind==p1 || kind==p2 || kind==p3 || kind==p4)
 				{
-					nextBoard.reset();
+					auto sliderRay = rays.firstRay(*it);
+					while(*rays.begin(sliderRay)!=towards)
+					{
+						++sliderRay;
+						assert(sliderRay!=rays.endRay(*it));
+					}
+					const auto entry = std::make_pair(*it, sliderRay);
+					if(std::find(sliderRays, sliderRays+sliderRayCount, entry)==sliderRays+sliderRayCount)
+					{
+						sliderRays[sliderRayCount++] = entry;
+					}
 				}
+				break;
 			}
 		}
 	};
-		// move to empty space
-		// with no possibility of attack
-		// (pawn move forward)
-	ChessMoveRecordingFunction functionNoTake[2][2] = 
-	{
-		// white turn
-		{
-			// white
-			functionTake[toArrayPosition(ChessPlayerColour::WHITE)][toArrayPosition(ChessPlayerColour::WHITE)],
-			// black
-			emptyFunction
-		},
-		// black turn
+	// the ray of a slider, walked on both boards at once until it is stopped on both
+	auto walkAgain = [&](const ChessRayTable &rays, ChessRayTable::Ray_t ray) {
+		bool parentOpen = true, boardOpen = true;
+		for(auto it = rays.begin(ray), end = rays.end(ray); it != end && (parentOpen || boardOpen); ++it)
 		{
-			// white
-			emptyFunction,
-			// black
-			functionTake[toArrayPosition(ChessPlayerColour::BLACK)][toArrayPosition(ChessPlayerColour::BLACK)]
+			// -1 on the parent and +1 on the board cancel out while both see the cell
+			if(parentOpen!=boardOpen)
+			{
+				record(*it, boardOpen);
+			}
+			parentOpen = parentOpen && (onParent(*it)==EMPTY_CELL);
+			boardOpen = boardOpen && (board->getPiecePos(*it)==EMPTY_CELL);
 		}
+		flush();
 	};
+	const ChessRayTable &rookRays = ChessRayTable::takeRays(ROOK_WHITE);
+	const ChessRayTable &bishopRays = ChessRayTable::takeRays(BISHOP_WHITE);
+	for(size_t i=0; i<changedCount; ++i)
+	{
+		findSliders(changed[i], rookRays, ROOK_WHITE, QUEEN_WHITE, EMPRESS_WHITE, AMAZON_WHITE);
+	}
+	const size_t rookRayCount = sliderRayCount;
+	for(size_t i=0; i<changedCount; ++i)
+	{
+		findSliders(changed[i], bishopRays, BISHOP_WHITE, QUEEN_WHITE, PRINCESS_WHITE, AMAZON_WHITE);
+	}
+	for(size_t i=0; i<sliderRayCount; ++i)
+	{
+		walkAgain(i<rookRayCount ? rookRays : bishopRays, sliderRays[i].second);
+	}
 	
-		// we could recapture on this square	
-	ChessMoveRecordingFunction functionDefend[2][2] = 
+	// the pieces of the changed cells, all their rays
+	for(size_t i=0; i<changedCount; ++i)
 	{
-		// white's turn
+		if(before[i]!=EMPTY_CELL)
+		{
+			defends(onParent, changed[i], before[i], -1);
+		}
+		const ChessPiece piece = board->getPiecePos(changed[i]);
+		if(piece!=EMPTY_CELL)
 		{
-			// white
-			[this](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {
-				//assert(maybeMove->getTurn()==ChessPlayerColour::WHITE);
-				
-				++underAttackByWhite[newPos];
-			},
-			// black
-			[this](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {
-				//assert(maybeMove->getTurn()==ChessPlayerColour::BLACK);
+			defends(onBoard, changed[i], piece, 1);
+		}
+	}
+	return true;
+}
 
-				++underAttackByWhite[newPos];
-			}
-		},
-		// black's turn
+bool ChessBoardAnalysis::isAttackMapValid() const
+{
+	const ChessBoard::ptr self(board);
+	ChessBoardAnalysis fresh(self);
+	fresh.attackMap.allocate();
+	
+	KingLines lines;
+	ChessMoveList moves;
+	fresh.calculateKingLines(lines);
+	fresh.calculatePossibleMoves_common(moves, lines, ALL_MOVES, true);
+	fresh.calculatePossibleMoves_enpassan(moves);
+	
+	return attackMap==fresh.attackMap;
+}
+
+void ChessBoardAnalysis::calculatePossibleMoves_common(ChessMoveList &moves, const KingLines &lines, MoveStage stage, bool maps)
+{
+	// in check the moves come from calculatePossibleMoves_evasions
+	const bool white = (board->getTurn()==ChessPlayerColour::WHITE);
+	if(lines.checkers!=0)
+	{
+		if(maps)
 		{
-			// white
-			[this](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {
-				//assert(maybeMove->getTurn()==ChessPlayerColour::WHITE);
-				
-				++underAttackByBlack[newPos];
-			},
-			// black
-			[this](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {
-				//assert(maybeMove->getTurn()==ChessPlayerColour::BLACK);
+			white ?
+				calculatePossibleMoves_common<ChessPlayerColour::WHITE, false, false, true>(moves, lines) :
+				calculatePossibleMoves_common<ChessPlayerColour::BLACK, false, false, true>(moves, lines);
+		}
+		return;
+	}
+	switch(stage)
+	{
+	case TAKES:
+		if(maps)
+		{
+			white ?
+				calculatePossibleMoves_common<ChessPlayerColour::WHITE, true, false, true>(moves, lines) :
+				calculatePossibleMoves_common<ChessPlayerColour::BLACK, true, false, true>(moves, lines);
+		}
+		else
+		{
+			white ?
+				calculatePossibleMoves_common<ChessPlayerColour::WHITE, true, false, false>(moves, lines) :
+				calculatePossibleMoves_common<ChessPlayerColour::BLACK, true, false, false>(moves, lines);
+		}
+		break;
+	case QUIETS:
+		assert(!maps); // made with the takes
+		white ?
+			calculatePossibleMoves_common<ChessPlayerColour::WHITE, false, true, false>(moves, lines) :
+			calculatePossibleMoves_common<ChessPlayerColour::BLACK, false, true, false>(moves, lines);
+		break;
+	case ALL_MOVES:
+		if(maps)
+		{
+			white ?
+				calculatePossibleMoves_common<ChessPlayerColour::WHITE, true, true, true>(moves, lines) :
+				calculatePossibleMoves_common<ChessPlayerColour::BLACK, true, true, true>(moves, lines);
+		}
+		else
+		{
+			white ?
+				calculatePossibleMoves_common<ChessPlayerColour::WHITE, true, true, false>(moves, lines) :
+				calculatePossibleMoves_common<ChessPlayerColour::BLACK, true, true, false>(moves, lines);
+		}
+		break;
+	}
+}
 
-				++underAttackByBlack[newPos];
-			}
+template<ChessPlayerColour turn, bool withTakes, bool withQuiets, bool withMaps>
+void ChessBoardAnalysis::calculatePossibleMoves_common(ChessMoveList &moves, const KingLines &lines)
+{
+	static_assert(withTakes || !withQuiets || !withMaps, "the maps need the takes walked");
+	assert(board->getTurn()==turn);
+	const bool withMoves = withTakes || withQuiets;
+	
+		// nothing to record
+	const auto ignore = [](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {};
+	
+		// take opponent's piece
+		// or
+		// move to empty space
+		// (the pieces of the side to move: off the lines to the king they aren't legal,
+		// the king's own are tested when picked)
+	const bool restricted = lines.isRestricted();
+	const auto recordMove = [&moves, &lines, restricted](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {
+		if(restricted && pos!=lines.king && !lines.allows(pos, newPos))
+		{
+			return;
+		}
+		moves.push_back(ChessCompactMove(pos, newPos));
+	};
+	
+		// we could recapture on this square
+		// (the attacks of both sides go to the map of the side to move)
+	const auto recordDefend = [this](ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) {
+		if(withMaps)
+		{
+			attackMap.increment(turn, newPos);
+		}
+	};
+	
+		// the visitors for the piece, with what it is walked for: the takes (and the defended cells),
+		// the moves to empty space and the moves with no possibility of attack (pawn move forward).
+		// the opponent's pieces are only walked for the maps
+	const auto visit = [&](ChessPiece curPiece, const auto &attempts) {
+		if(withMoves && getColour(curPiece)==turn)
+		{
+			attempts(recordMove, recordDefend, withTakes || withMaps, withQuiets, withQuiets);
+		}
+		else if(withMaps)
+		{
+			attempts(ignore, recordDefend, true, true, false);
 		}
 	};
 
 	// main common moves
-	for(ChessBoard::BoardPosition_t pos=0, end=ChessBoard::param.cellCount; pos!=end; ++pos)
-	{
-		auto curPiece = board->getPiecePos(pos);
-		if(curPiece == EMPTY_CELL) continue;
-		
-		auto pieceParam = moveParameters.at(curPiece);
-		auto moveArrayPos = toArrayPosition(board->getTurn());
-		auto pieceArrayPos = toArrayPosition(getColour(curPiece));
-		
-		if(pieceParam->isDifferentMoveTypes)
+	
+		// visiting only the occupied cells, only the own ones without the maps.
+		// the attacked cells go to the map as a set, the moves are walked for the moves only
+	auto bitboardMoves = [&](const auto &bb) {
+		for(auto occupied = withMaps ? bb.getOccupied() : bb.getColour(turn); occupied; )
 		{
-			ChessMove::moveAttempts(functionNoTake[moveArrayPos][pieceArrayPos], emptyFunction,
-				*board, pos,
-				*pieceParam->noTakeMove, false);
-			ChessMove::moveAttempts(functionTake[moveArrayPos][pieceArrayPos],
-				functionDefend[moveArrayPos][pieceArrayPos],
-				*board, pos,
-				*pieceParam->takeMove, true, false);
+			auto pos = popFirstBit(occupied);
+			auto curPiece = board->getPiecePos(pos);
+			auto pieceParam = moveParameters.at(curPiece);
+			const auto attacks = bb.attacks(curPiece, pos);
+			
+			if(withMaps)
+			{
+				attackMap.add(turn, attacks);
+			}
+			if(!withMoves || getColour(curPiece)!=turn)
+			{
+				continue;
+			}
+			if(pieceParam->isDifferentMoveTypes)
+			{
+				if(withQuiets)
+				{
+					ChessMove::moveAttempts(recordMove, ignore,
+						*board, bb, pos,
+						bb.quietMoves(curPiece, pos), false);
+				}
+				if(withTakes)
+				{
+					ChessMove::moveAttempts(recordMove, ignore,
+						*board, bb, pos,
+						attacks & bb.getOccupied(), true, false);
+				}
+			}
+			else
+			{
+				ChessMove::moveAttempts(recordMove, ignore,
+					*board, bb, pos,
+					withQuiets ? attacks : attacks & bb.getOccupied(), withTakes, withQuiets);
+			}
 		}
-		else
+	};
+	if(board->bitboard())
+	{
+		bitboardMoves(*board->bitboard());
+		return;
+	}
+	if(board->wideBitboard())
+	{
+		bitboardMoves(*board->wideBitboard());
+		return;
+	}
+	if(board->paddedMailbox())
+	{
+		const ChessPaddedMailbox &pm = *board->paddedMailbox();
+		const ChessPieceList &pl = *board->pieceList();
+		for(const auto &entry : pl)
 		{
-			ChessMove::moveAttempts(functionTake[moveArrayPos][pieceArrayPos],
-				functionDefend[moveArrayPos][pieceArrayPos],
-				*board, pos, *pieceParam->anyMove, true);
+			auto pos = entry.pos;
+			auto curPiece = entry.piece;
+			auto pieceParam = moveParameters.at(curPiece);
+			
+			visit(curPiece, [&](const auto &record, const auto &recordDefend, bool canTake, bool canMoveToEmpty, bool noTakes) {
+				if(pieceParam->isDifferentMoveTypes)
+				{
+					if(noTakes)
+					{
+						ChessMove::moveAttempts(record, ignore,
+							*board, pm, pos,
+							ChessPaddedMailbox::noTakeDirections(curPiece), false);
+					}
+					if(canTake)
+					{
+						ChessMove::moveAttempts(record, recordDefend,
+							*board, pm, pos,
+							ChessPaddedMailbox::takeDirections(curPiece), true, false);
+					}
+				}
+				else
+				{
+					ChessMove::moveAttempts(record, recordDefend,
+						*board, pm, pos, ChessPaddedMailbox::takeDirections(curPiece), canTake, canMoveToEmpty);
+				}
+			});
 		}
+		return;
+	}
+	
+		// the cells come from the ray tables, clipped to the board already
+	const ChessPieceList &pl = *board->pieceList();
+	for(const auto &entry : pl)
+	{
+		auto pos = entry.pos;
+		auto curPiece = entry.piece;
+		auto pieceParam = moveParameters.at(curPiece);
+		
+		visit(curPiece, [&](const auto &record, const auto &recordDefend, bool canTake, bool canMoveToEmpty, bool noTakes) {
+			if(pieceParam->isDifferentMoveTypes)
+			{
+				if(noTakes)
+				{
+					ChessMove::moveAttempts(record, ignore,
+						*board, pos,
+						*pieceParam->noTakeRays, false);
+				}
+				if(canTake)
+				{
+					ChessMove::moveAttempts(record, recordDefend,
+						*board, pos,
+						*pieceParam->takeRays, true, false);
+				}
+			}
+			else
+			{
+				ChessMove::moveAttempts(record, recordDefend,
+					*board, pos, *pieceParam->anyRays, canTake, canMoveToEmpty);
+			}
+		});
 	}
 }
-void ChessBoardAnalysis::calculatePossibleMoves_pawnfirst()
+void ChessBoardAnalysis::calculatePossibleMoves_pawnfirst(ChessMoveList &moves, const KingLines &lines)
 {
 	if(board->getTurn()==ChessPlayerColour::WHITE)
 	{
@@ -236,16 +658,9 @@ void ChessBoardAnalysis::calculatePossibleMoves_pawnfirst()
 				auto newPos = pos+2*ChessBoard::param.width;
 				if(board->getPiecePos(newPos)==EMPTY_CELL)
 				{
-					auto nextBoard = factory.createBoard(this->board, pos, newPos);
-					
-					if(ChessMove::isMovePossible(nextBoard))
-					{
-						nextBoard->enPassan=enPassan;
-						this->possibleMoves->push_back(nextBoard);
-					}
-					else
+					if(!lines.isRestricted() || lines.allows(pos, newPos))
 					{
-						nextBoard.reset();
+						moves.push_back(ChessCompactMove(pos, newPos, ChessCompactMove::DOUBLE_PUSH));
 					}
 				}
 			}
@@ -254,7 +669,7 @@ void ChessBoardAnalysis::calculatePossibleMoves_pawnfirst()
 	else // if ChessPlayerColour::Black
 	{
 		// process black pawns on first ranks
-		for(ChessBoard::BoardPosition_t pos = ChessBoard::param.cellCount-1, end=ChessBoard::param.cellCount - (ChessBoard::param.width*2) -1; pos>=end; --pos)
+		for(ChessBoard::BoardPosition_t pos = ChessBoard::param.cellCount-1, end=ChessBoard::param.cellCount - ChessBoard::param.width*2; pos>=end; --pos)
 		{
 			
 			auto curPiece = board->getPiecePos(pos);
@@ -266,16 +681,9 @@ void ChessBoardAnalysis::calculatePossibleMoves_pawnfirst()
 				auto newPos = pos-2*ChessBoard::param.width;
 				if(board->getPiecePos(newPos)==EMPTY_CELL)
 				{
-					auto nextBoard = factory.createBoard(this->board, pos, newPos);
-					
-					if(ChessMove::isMovePossible(nextBoard))
+					if(!lines.isRestricted() || lines.allows(pos, newPos))
 					{
-						nextBoard->enPassan=enPassan;
-						this->possibleMoves->push_back(nextBoard);
-					}
-					else
-					{
-						nextBoard.reset();
+						moves.push_back(ChessCompactMove(pos, newPos, ChessCompactMove::DOUBLE_PUSH));
 					}
 				}
 			}
@@ -283,50 +691,41 @@ void ChessBoardAnalysis::calculatePossibleMoves_pawnfirst()
 	}
 }
 
-void ChessBoardAnalysis::calculatePossibleMoves_enpassan()
+void ChessBoardAnalysis::calculatePossibleMoves_enpassan(ChessMoveList &moves)
 {
+	const auto enPassan = board->getEnPassan();
 	if(board->getTurn()==ChessPlayerColour::WHITE)
 	{
 		// process en passan rules
-		if(board->enPassan!=ChessBoard::param.cellCount)
+		if(enPassan!=ChessBoard::param.cellCount)
 		{
 			// test left
-			if(board->enPassan % ChessBoard::param.width != 0)
+			if(enPassan % ChessBoard::param.width != 0)
 			{
-				auto pos = board->enPassan - ChessBoard::param.width - 1;
+				auto pos = enPassan - ChessBoard::param.width - 1;
 				if(board->getPiecePos(pos)==PAWN_WHITE)
 				{
-					auto nextBoard = factory.createBoard(this->board, pos, board->enPassan);
-					
-					if(ChessMove::isMovePossible(nextBoard))
-					{
-						++underAttackByWhite[pos+1];
-						nextBoard->placePiecePos(pos+1, EMPTY_CELL);
-						this->possibleMoves->push_back(nextBoard);
-					}
-					else
+					const ChessCompactMove move(pos, enPassan, ChessCompactMove::EN_PASSAN);
+					if(ChessMove::isMovePossible(*this->board, move))
 					{
-						nextBoard.reset();
+						attackMap.increment(ChessPlayerColour::WHITE, pos+1);
+						++enPassanTakes;
+						moves.push_back(move);
 					}
 				}
 			}
 			// test right
-			if(board->enPassan % ChessBoard::param.width != ChessBoard::param.width-1)
+			if(enPassan % ChessBoard::param.width != ChessBoard::param.width-1)
 			{
-				auto pos = board->enPassan - ChessBoard::param.width + 1;
+				auto pos = enPassan - ChessBoard::param.width + 1;
 				if(board->getPiecePos(pos)==PAWN_WHITE)
 				{
-					auto nextBoard = factory.createBoard(this->board, pos, board->enPassan);
-					
-					if(ChessMove::isMovePossible(nextBoard))
+					const ChessCompactMove move(pos, enPassan, ChessCompactMove::EN_PASSAN);
+					if(ChessMove::isMovePossible(*this->board, move))
 					{
-						++underAttackByWhite[pos-1];
-						nextBoard->placePiecePos(pos-1, EMPTY_CELL);
-						this->possibleMoves->push_back(nextBoard);
-					}
-					else
-					{
-						nextBoard.reset();
+						attackMap.increment(ChessPlayerColour::WHITE, pos-1);
+						++enPassanTakes;
+						moves.push_back(move);
 					}
 				}
 			}
@@ -334,46 +733,36 @@ void ChessBoardAnalysis::calculatePossibleMoves_enpassan()
 	}
 	else // if ChessPlayerColour::Black
 	{
-		if(board->enPassan!=ChessBoard::param.cellCount)
+		if(enPassan!=ChessBoard::param.cellCount)
 		{
 			// test left
-			if(board->enPassan % ChessBoard::param.width != 0)
+			if(enPassan % ChessBoard::param.width != 0)
 			{
-				auto pos = board->enPassan + ChessBoard::param.width - 1;
+				auto pos = enPassan + ChessBoard::param.width - 1;
 				if(board->getPiecePos(pos)==PAWN_BLACK)
 				{
-					auto nextBoard = factory.createBoard(this->board, pos, board->enPassan);
-					
-					if(ChessMove::isMovePossible(nextBoard))
+					const ChessCompactMove move(pos, enPassan, ChessCompactMove::EN_PASSAN);
+					if(ChessMove::isMovePossible(*this->board, move))
 					{
-						++underAttackByBlack[pos+1];
-						nextBoard->placePiecePos(pos+1, EMPTY_CELL);
-						this->possibleMoves->push_back(nextBoard);
-					}
-					else
-					{
-						nextBoard.reset();
+						attackMap.increment(ChessPlayerColour::BLACK, pos+1);
+						++enPassanTakes;
+						moves.push_back(move);
 					}
 				}
 			}
 			// test right
-			if(board->enPassan % ChessBoard::param.width != ChessBoard::param.width-1)
+			if(enPassan % ChessBoard::param.width != ChessBoard::param.width-1)
 			{
-				auto pos = board->enPassan + ChessBoard::param.width + 1;
+				auto pos = enPassan + ChessBoard::param.width + 1;
 
 				if(board->getPiecePos(pos)==PAWN_BLACK)
 				{
-					auto nextBoard = factory.createBoard(this->board, pos, board->enPassan);
-					
-					if(ChessMove::isMovePossible(nextBoard))
-					{
-						++underAttackByBlack[pos-1];
-						nextBoard->placePiecePos(pos-1, EMPTY_CELL);
-						this->possibleMoves->push_back(nextBoard);
-					}
-					else
+					const ChessCompactMove move(pos, enPassan, ChessCompactMove::EN_PASSAN);
+					if(ChessMove::isMovePossible(*this->board, move))
 					{
-						nextBoard.reset();
+						attackMap.increment(ChessPlayerColour::BLACK, pos-1);
+						++enPassanTakes;
+						moves.push_back(move);
 					}
 				}
 			}
@@ -381,22 +770,33 @@ void ChessBoardAnalysis::calculatePossibleMoves_enpassan()
 	}
 }
 
-void ChessBoardAnalysis::calculatePossibleMoves_castling()
+void ChessBoardAnalysis::calculatePossibleMoves_castling(ChessMoveList &moves)
 {
+	const auto whiteKing = board->getKingPos(ChessPlayerColour::WHITE);
+	const auto blackKing = board->getKingPos(ChessPlayerColour::BLACK);
+	const ChessBoard::BoardPosition_t whiteCastling[2] =
+		{ board->getCastling(ChessPlayerColour::WHITE, 0), board->getCastling(ChessPlayerColour::WHITE, 1) };
+	const ChessBoard::BoardPosition_t blackCastling[2] =
+		{ board->getCastling(ChessPlayerColour::BLACK, 0), board->getCastling(ChessPlayerColour::BLACK, 1) };
+	// the king is not in check and the cell it passes isn't attacked: tested as the king's step onto it
+	// (the attack maps can't tell, they count the attacks of both sides together)
+	const auto isPassable = [this](ChessBoard::BoardPosition_t king, ChessBoard::BoardPosition_t cell) {
+		return ChessMove::isMovePossible(*this->board, ChessCompactMove(king, cell));
+	};
+	
 	if(board->getTurn()==ChessPlayerColour::WHITE)
 	{
 		// process castling rules
-		if(board->whiteCastling[0]!=ChessBoard::param.cellCount) // if can castle left
+		if(whiteCastling[0]!=ChessBoard::param.cellCount) // if can castle left
 		{
-			assert(board->getPiecePos(board->whiteCastling[0])==ROOK_WHITE);
+			assert(board->getPiecePos(whiteCastling[0])==ROOK_WHITE);
 			if(
-				underAttackByBlack[board->whiteKingPos[0]] == 0 &&
-				underAttackByBlack[board->whiteKingPos[0]-1] == 0)
+				!check && isPassable(whiteKing, whiteKing-1))
 			{
-				if(board->whiteKingPos[1] >=2) // farther than 2 files from the edge
+				if(whiteKing % ChessBoard::param.width >=2) // farther than 2 files from the edge
 				{
 					bool allEmpty = true;
-					for(ChessBoard::BoardPosition_t cell = board->whiteCastling[0]+1; cell<board->whiteKingPos[0]; ++cell)
+					for(ChessBoard::BoardPosition_t cell = whiteCastling[0]+1; cell<whiteKing; ++cell)
 					{
 						if(board->getPiecePos(cell)!=EMPTY_CELL)
 						{
@@ -404,45 +804,33 @@ void ChessBoardAnalysis::calculatePossibleMoves_castling()
 							break;
 						}
 					}
-					if(allEmpty && underAttackByBlack[board->whiteKingPos[0]-2] == 0)
+					if(allEmpty)
 					{
-						auto nextBoard = factory.createBoard(this->board, 
-							board->whiteKingPos[0], board->whiteKingPos[0]-2, // move king
-							board->whiteCastling[0], board->whiteKingPos[0]-1 // move rook
-							);
-						if(ChessMove::isMovePossible(nextBoard))
+						const ChessCompactMove move(whiteKing, whiteKing-2, ChessCompactMove::CASTLING);
+						if(ChessMove::isMovePossible(*this->board, move))
 						{
-							this->possibleMoves->push_back(nextBoard);
-						}
-						else
-						{
-							nextBoard.reset();
+							moves.push_back(move);
 						}
 					}
 				}
 				else
 				{
-					auto nextBoard = factory.createBoard(this->board, 
-						board->whiteKingPos[0], board->whiteKingPos[0]-1, // move king
-						board->whiteCastling[0], board->whiteKingPos[0] // move rook
-						);
-					// not checking if move is possible, because we know that the cell on the left isn't
-					// being attacked. note, that it cannot be assumed in the normal castling
-					this->possibleMoves->push_back(nextBoard);
+					const ChessCompactMove move(whiteKing, whiteKing-1, ChessCompactMove::CASTLING);
+					// not checking if move is possible, the cell the king goes to has been tested
+					moves.push_back(move);
 				}
 			}
 		}
-		if(board->whiteCastling[1]!=ChessBoard::param.cellCount) // if can castle right
+		if(whiteCastling[1]!=ChessBoard::param.cellCount) // if can castle right
 		{
-			assert(board->getPiecePos(board->whiteCastling[1])==ROOK_WHITE);
+			assert(board->getPiecePos(whiteCastling[1])==ROOK_WHITE);
 			if(
-				underAttackByBlack[board->whiteKingPos[0]] == 0 &&
-				underAttackByBlack[board->whiteKingPos[0]+1] == 0)
+				!check && isPassable(whiteKing, whiteKing+1))
 			{
-				if(board->whiteKingPos[1] < ChessBoard::param.width-2) // farther than 2 files from the edge
+				if(whiteKing % ChessBoard::param.width < ChessBoard::param.width-2) // farther than 2 files from the edge
 				{
 					bool allEmpty = true;
-					for(ChessBoard::BoardPosition_t cell = board->whiteCastling[0]+1; cell<board->whiteKingPos[0]; ++cell)
+					for(ChessBoard::BoardPosition_t cell = whiteKing+1; cell<whiteCastling[1]; ++cell)
 					{
 						if(board->getPiecePos(cell)!=EMPTY_CELL)
 						{
@@ -450,31 +838,20 @@ void ChessBoardAnalysis::calculatePossibleMoves_castling()
 							break;
 						}
 					}
-					if(allEmpty &&underAttackByBlack[board->whiteKingPos[0]+2] == 0)
+					if(allEmpty)
 					{
-						auto nextBoard = factory.createBoard(this->board, 
-							board->whiteKingPos[0], board->whiteKingPos[0]+2, // move king
-							board->whiteCastling[1], board->whiteKingPos[0]+1 // move rook
-							);
-						if(ChessMove::isMovePossible(nextBoard))
-						{
-							this->possibleMoves->push_back(nextBoard);
-						}
-						else
+						const ChessCompactMove move(whiteKing, whiteKing+2, ChessCompactMove::CASTLING);
+						if(ChessMove::isMovePossible(*this->board, move))
 						{
-							nextBoard.reset();
+							moves.push_back(move);
 						}
 					}
 				}
 				else
 				{
-					auto nextBoard = factory.createBoard(this->board, 
-						board->whiteKingPos[0], board->whiteKingPos[0]+1, // move king
-						board->whiteCastling[1], board->whiteKingPos[0] // move rook
-						);
-					// not checking if move is possible, because we know that the cell on the left isn't
-					// being attacked. note, that it cannot be assumed in the normal castling
-					this->possibleMoves->push_back(nextBoard);
+					const ChessCompactMove move(whiteKing, whiteKing+1, ChessCompactMove::CASTLING);
+					// not checking if move is possible, the cell the king goes to has been tested
+					moves.push_back(move);
 				}
 			}
 		}
@@ -482,17 +859,16 @@ void ChessBoardAnalysis::calculatePossibleMoves_castling()
 	else // if ChessPlayerColour::Black
 	{
 		// process castling rules
-		if(board->blackCastling[0]!=ChessBoard::param.cellCount) // if can castle left
+		if(blackCastling[0]!=ChessBoard::param.cellCount) // if can castle left
 		{
-			assert(board->getPiecePos(board->blackCastling[0])==ROOK_BLACK);
+			assert(board->getPiecePos(blackCastling[0])==ROOK_BLACK);
 			if(
-				underAttackByWhite[board->blackKingPos[0]] == 0 &&
-				underAttackByWhite[board->blackKingPos[0]-1] == 0)
+				!check && isPassable(blackKing, blackKing-1))
 			{
-				if(board->blackKingPos[1] >=2) // farther than 2 files from the edge
+				if(blackKing % ChessBoard::param.width >=2) // farther than 2 files from the edge
 				{
 					bool allEmpty = true;
-					for(ChessBoard::BoardPosition_t cell = board->blackCastling[0]+1; cell<board->blackKingPos[0]; ++cell)
+					for(ChessBoard::BoardPosition_t cell = blackCastling[0]+1; cell<blackKing; ++cell)
 					{
 						if(board->getPiecePos(cell)!=EMPTY_CELL)
 						{
@@ -500,45 +876,33 @@ void ChessBoardAnalysis::calculatePossibleMoves_castling()
 							break;
 						}
 					}
-					if(allEmpty && underAttackByWhite[board->blackKingPos[0]-2] == 0)
+					if(allEmpty)
 					{
-						auto nextBoard = factory.createBoard(this->board, 
-							board->blackKingPos[0], board->blackKingPos[0]-2, // move king
-							board->blackCastling[0], board->blackKingPos[0]-1 // move rook
-							);
-						if(ChessMove::isMovePossible(nextBoard))
-						{
-							this->possibleMoves->push_back(nextBoard);
-						}
-						else
+						const ChessCompactMove move(blackKing, blackKing-2, ChessCompactMove::CASTLING);
+						if(ChessMove::isMovePossible(*this->board, move))
 						{
-							nextBoard.reset();
+							moves.push_back(move);
 						}
 					}
 				}
 				else
 				{
-					auto nextBoard = factory.createBoard(this->board, 
-						board->blackKingPos[0], board->blackKingPos[0]-1, // move king
-						board->blackCastling[0], board->blackKingPos[0] // move rook
-						);
-					// not checking if move is possible, because we know that the cell on the left isn't
-					// being attacked. note, that it cannot be assumed in the normal castling
-					this->possibleMoves->push_back(nextBoard);
+					const ChessCompactMove move(blackKing, blackKing-1, ChessCompactMove::CASTLING);
+					// not checking if move is possible, the cell the king goes to has been tested
+					moves.push_back(move);
 				}
 			}
 		}
-		if(board->blackCastling[1]!=ChessBoard::param.cellCount) // if can castle right
+		if(blackCastling[1]!=ChessBoard::param.cellCount) // if can castle right
 		{
-			assert(board->getPiecePos(board->blackCastling[1])==ROOK_BLACK);
+			assert(board->getPiecePos(blackCastling[1])==ROOK_BLACK);
 			if(
-				underAttackByWhite[board->blackKingPos[0]] == 0 &&
-				underAttackByWhite[board->blackKingPos[0]+1] == 0)
+				!check && isPassable(blackKing, blackKing+1))
 			{
-				if(board->blackKingPos[1] < ChessBoard::param.width-2) // farther than 2 files from the edge
+				if(blackKing % ChessBoard::param.width < ChessBoard::param.width-2) // farther than 2 files from the edge
 				{
 					bool allEmpty = true;
-					for(ChessBoard::BoardPosition_t cell = board->blackCastling[0]+1; cell<board->blackKingPos[0]; ++cell)
+					for(ChessBoard::BoardPosition_t cell = blackKing+1; cell<blackCastling[1]; ++cell)
 					{
 						if(board->getPiecePos(cell)!=EMPTY_CELL)
 						{
@@ -546,61 +910,307 @@ void ChessBoardAnalysis::calculatePossibleMoves_castling()
 							break;
 						}
 					}
-					if(allEmpty && underAttackByWhite[board->blackKingPos[0]+2] == 0)
+					if(allEmpty)
 					{
-						auto nextBoard = factory.createBoard(this->board, 
-							board->blackKingPos[0], board->blackKingPos[0]+2, // move king
-							board->blackCastling[1], board->blackKingPos[0]+1 // move rook
-							);
-						if(ChessMove::isMovePossible(nextBoard))
+						const ChessCompactMove move(blackKing, blackKing+2, ChessCompactMove::CASTLING);
+						if(ChessMove::isMovePossible(*this->board, move))
 						{
-							this->possibleMoves->push_back(nextBoard);
-						}
-						else
-						{
-							nextBoard.reset();
+							moves.push_back(move);
 						}
 					}
 				}
 				else
 				{
-					auto nextBoard = factory.createBoard(this->board, 
-						board->blackKingPos[0], board->blackKingPos[0]+1, // move king
-						board->blackCastling[1], board->blackKingPos[0] // move rook
-						);
-					// not checking if move is possible, because we know that the cell on the left isn't
-					// being attacked. note, that it cannot be assumed in the normal castling
-					this->possibleMoves->push_back(nextBoard);
+					const ChessCompactMove move(blackKing, blackKing+1, ChessCompactMove::CASTLING);
+					// not checking if move is possible, the cell the king goes to has been tested
+					moves.push_back(move);
 				}
 			}
 		}
 	}
 }
 
-void ChessBoardAnalysis::calculatePossibleMoves()
+void ChessBoardAnalysis::calculatePossibleMoves_evasions(ChessMoveList &moves, const KingLines &lines)
+{
+	assert(lines.checkers!=0);
+	const ChessPlayerColour turn = board->getTurn();
+	const bool white = (turn==ChessPlayerColour::WHITE);
+	
+	// the king steps aside or takes, tested when picked like the other moves of the king
+	const ChessRayTable &kingRays = ChessRayTable::takeRays(white ? KING_WHITE : KING_BLACK);
+	for(auto ray = kingRays.firstRay(lines.king), rayEnd = kingRays.endRay(lines.king); ray != rayEnd; ++ray)
+	{
+		for(auto it = kingRays.begin(ray), end = kingRays.end(ray); it != end; ++it)
+		{
+			const ChessPiece piece = board->getPiecePos(*it);
+			if(piece==EMPTY_CELL || getColour(piece)!=turn)
+			{
+				moves.push_back(ChessCompactMove(lines.king, *it));
+			}
+		}
+	}
+	if(lines.checkers>1)
+	{
+		return;
+	}
+	
+	// the pieces that take the checker or step on the line between, looked for from the cell of the line
+	// the way the checkers are looked for from the king
+	auto reach = [&](ChessBoard::BoardPosition_t target, const ChessRayTable &rays, bool sliding,
+		ChessPiece p1, ChessPiece p2, ChessPiece p3, ChessPiece p4) {
+		for(auto ray = rays.firstRay(target), rayEnd = rays.endRay(target); ray != rayEnd; ++ray)
+		{
+			for(auto it = rays.begin(ray), end = rays.end(ray); it != end; ++it)
+			{
+				const ChessPiece piece = board->getPiecePos(*it);
+				if(piece==EMPTY_CELL && sliding)
+				{
+					continue;
+				}
+				if((piece==p1 || piece==p2 || piece==p3 || piece==p4) && lines.allows(*it, target)) // not pinned
+				{
+					moves.push_back(ChessCompactMove(*it, target));
+				}
+				break;
+			}
+		}
+	};
+	for(auto it = lines.check.begin; it != lines.check.end; ++it)
+	{
+		const ChessBoard::BoardPosition_t target = *it;
+		if(white)
+		{
+			reach(target, ChessRayTable::takeRays(ROOK_WHITE), true, ROOK_WHITE, QUEEN_WHITE, EMPRESS_WHITE, AMAZON_WHITE);
+			reach(target, ChessRayTable::takeRays(BISHOP_WHITE), true, BISHOP_WHITE, QUEEN_WHITE, PRINCESS_WHITE, AMAZON_WHITE);
+			reach(target, ChessRayTable::takeRays(KNIGHT_WHITE), false, KNIGHT_WHITE, PRINCESS_WHITE, EMPRESS_WHITE, AMAZON_WHITE);
+			// a pawn is found from the cell by the moves of the opponent's pawn: it takes the checker, steps between
+			reach(target, target==lines.check.pos ? ChessRayTable::takeRays(PAWN_BLACK) : ChessRayTable::noTakeRays(PAWN_BLACK),
+				false, PAWN_WHITE, PAWN_WHITE, PAWN_WHITE, PAWN_WHITE);
+		}
+		else
+		{
+			reach(target, ChessRayTable::takeRays(ROOK_WHITE), true, ROOK_BLACK, QUEEN_BLACK, EMPRESS_BLACK, AMAZON_BLACK);
+			reach(target, ChessRayTable::takeRays(BISHOP_WHITE), true, BISHOP_BLACK, QUEEN_BLACK, PRINCESS_BLACK, AMAZON_BLACK);
+			reach(target, ChessRayTable::takeRays(KNIGHT_WHITE), false, KNIGHT_BLACK, PRINCESS_BLACK, EMPRESS_BLACK, AMAZON_BLACK);
+			reach(target, target==lines.check.pos ? ChessRayTable::takeRays(PAWN_WHITE) : ChessRayTable::noTakeRays(PAWN_WHITE),
+				false, PAWN_BLACK, PAWN_BLACK, PAWN_BLACK, PAWN_BLACK);
+		}
+	}
+}
+
+void ChessBoardAnalysis::startPossibleMoves()
 {
 	if(possibleMoves != nullptr)
 	{
 		return;
 	}
 
-	underAttackByBlack = new int8_t[ChessBoard::param.cellCount]{};
-	underAttackByWhite = new int8_t[ChessBoard::param.cellCount]{};
+	attackMap.allocate();
 
-	possibleMoves=new std::vector<ChessBoard::ptr>();
+	// the captures first: the walk over the pieces makes the attack maps unless they are derived,
+	// the special ones are tested already, the king's wait until they are picked
+	KingLines lines;
+	calculateKingLines(lines);
+	check = (lines.checkers!=0);
+	const bool derived = deriveAttackMaps();
+	
+	ChessMoveList moves;
+	
+	calculatePossibleMoves_common(moves, lines, TAKES, !derived);
+	if(check)
+	{
+		calculatePossibleMoves_evasions(moves, lines);
+	}
+	calculatePossibleMoves_enpassan(moves);
+#ifdef CHESS_VERIFY_ATTACK_MAPS
+	assert(!derived || isAttackMapValid());
+#endif
+	
+	possibleMoves = new std::vector<PossibleMove>();
+	quietsPending = true;
+	setPendingMoves(moves);
+	if(check)
+	{
+		hasPossibleMove(0);
+	}
+}
+
+void ChessBoardAnalysis::calculateQuietMoves()
+{
+	assert(quietsPending && !pendingMoves);
+	quietsPending = false;
+	board->makeIFrame(); // in case the budget has demoted it since the start
+	
+	// in check the evasions are all generated already, but the double steps of the pawns
+	KingLines lines;
+	calculateKingLines(lines);
+	
+	ChessMoveList moves;
+	
+	calculatePossibleMoves_common(moves, lines, QUIETS, false);
+	calculatePossibleMoves_pawnfirst(moves, lines);
+	calculatePossibleMoves_castling(moves);
+	
+	setPendingMoves(moves);
+}
+
+void ChessBoardAnalysis::setPendingMoves(ChessMoveList &moves)
+{
+	assert(!pendingMoves);
+	if(moves.empty())
+	{
+		return;
+	}
+	
+	// the scored ones first, ordered only as they are picked; the others stay as they were generated
+	thread_local std::vector<uint8_t> checkCells;
+	checkCells.resize(ChessBoard::param.cellCount);
+	calculateCheckCells(checkCells.data());
+	size_t scored = 0;
+	for(auto &entry : moves)
+	{
+		entry.score = scoreMove(entry.move, checkCells.data());
+		if(entry.score)
+		{
+			std::swap(entry, moves[scored++]);
+		}
+	}
+	
+	pendingMoves = new std::vector<PendingMove>(moves.size());
+	pendingNext = 0;
+	pendingScored = (uint32_t)scored;
+	for(size_t i=0, end=moves.size(); i<end; ++i)
+	{
+		(*pendingMoves)[i] = PendingMove{ moves[i].move, (int32_t)moves[i].score };
+	}
+}
 
-	calculatePossibleMoves_common();
-	calculatePossibleMoves_pawnfirst();
-	calculatePossibleMoves_enpassan();
-	calculatePossibleMoves_castling();
+void ChessBoardAnalysis::calculateCheckCells(uint8_t* cells) const
+{
+	const ChessPlayerColour turn = board->getTurn();
+	const auto king = board->getKingPos(!turn);
+	std::fill(cells, cells+ChessBoard::param.cellCount, 0);
 	
-	std::sort(possibleMoves->begin(), possibleMoves->end(),
-			[](ChessBoard::ptr &l, ChessBoard::ptr &r) -> bool {
-				return ChessBoardAnalysis(l).chessPiecesWeight() < ChessBoardAnalysis(r).chessPiecesWeight();
+	// from the other king up to and including the first piece, the moves are symmetric but the pawns'
+	auto walk = [&](const ChessRayTable &rays, uint8_t line) {
+		for(auto ray = rays.firstRay(king), rayEnd = rays.endRay(king); ray != rayEnd; ++ray)
+		{
+			for(auto it = rays.begin(ray), end = rays.end(ray); it != end; ++it)
+			{
+				cells[*it] |= line;
+				if(board->getPiecePos(*it)!=EMPTY_CELL)
+				{
+					break;
+				}
 			}
-		);
+		}
+	};
+	walk(ChessRayTable::takeRays(ROOK_WHITE), ROOK_LINE);
+	walk(ChessRayTable::takeRays(BISHOP_WHITE), BISHOP_LINE);
+	walk(ChessRayTable::takeRays(KNIGHT_WHITE), KNIGHT_LINE);
+	walk(ChessRayTable::takeRays(turn==ChessPlayerColour::WHITE ? PAWN_BLACK : PAWN_WHITE), PAWN_LINE);
+}
+
+weight_type ChessBoardAnalysis::scoreMove(const ChessCompactMove &move, const uint8_t* checkCells) const
+{
+	const ChessPiece moving = board->getPiecePos(move.from);
+	const ChessPiece taken = move.kind==ChessCompactMove::EN_PASSAN ?
+		board->getPiecePos(move.getTaken(ChessBoard::param)) :
+		move.kind==ChessCompactMove::NORMAL ? board->getPiecePos(move.to) :
+		EMPTY_CELL;
+	const ChessPiece becomes = move.promotion!=EMPTY_CELL ? (ChessPiece)move.promotion : moving;
 	
-	possibleMoves->shrink_to_fit();
+	weight_type score = 0;
+	if(taken!=EMPTY_CELL)
+	{
+		score += CAPTURE_SCORE + victimWeight(taken)*VICTIM_SCORE - victimWeight(moving);
+	}
+	if(move.promotion!=EMPTY_CELL)
+	{
+		score += PROMOTION_SCORE + victimWeight(becomes)*VICTIM_SCORE;
+	}
+	if(move.kind!=ChessCompactMove::CASTLING && (checkCells[move.to] & checkLines(becomes)))
+	{
+		score += CHECK_SCORE; // not the discovered ones
+	}
+	return score;
+}
+
+void ChessBoardAnalysis::pickPossibleMove()
+{
+	assert(pendingMoves!=nullptr && pendingNext<pendingMoves->size());
+	if(pendingNext < pendingScored)
+	{
+		// the greatest score of the rest comes next, the first of the equal ones
+		auto &pending = *pendingMoves;
+		uint32_t best = pendingNext;
+		for(uint32_t i=pendingNext+1; i<pendingScored; ++i)
+		{
+			if(pending[i].score > pending[best].score)
+			{
+				best = i;
+			}
+		}
+		std::swap(pending[pendingNext], pending[best]);
+	}
+	const ChessCompactMove move = (*pendingMoves)[pendingNext++].move;
+	
+	bool legal = true; // the rest keep to the lines to the king
+	if(move.kind==ChessCompactMove::NORMAL && move.from==board->getKingPos(board->getTurn()))
+	{
+		board->makeIFrame(); // in case the budget has demoted it since the start
+		legal = ChessMove::isMovePossible(*board, move);
+	}
+	if(legal)
+	{
+		possibleMoves->push_back(PossibleMove{ move, nullptr });
+	}
+	if(pendingNext==pendingMoves->size())
+	{
+		delete pendingMoves;
+		pendingMoves = nullptr;
+		pendingNext = 0;
+		pendingScored = 0;
+	}
+}
+
+bool ChessBoardAnalysis::hasPossibleMove(size_t i)
+{
+	assert(possibleMoves!=nullptr);
+	while(i>=possibleMoves->size())
+	{
+		if(pendingMoves)
+		{
+			pickPossibleMove();
+		}
+		else if(quietsPending)
+		{
+			calculateQuietMoves();
+		}
+		else
+		{
+			break;
+		}
+	}
+	return i<possibleMoves->size();
+}
+
+void ChessBoardAnalysis::calculatePossibleMoves()
+{
+	startPossibleMoves();
+	while(pendingMoves || quietsPending)
+	{
+		if(!pendingMoves)
+		{
+			calculateQuietMoves();
+			continue;
+		}
+		possibleMoves->reserve(possibleMoves->size() + pendingMoves->size() - pendingNext);
+		while(pendingMoves)
+		{
+			pickPossibleMove();
+		}
+	}
 }
 
 weight_type ChessBoardAnalysis::chessPositionWeight(bool log) const
@@ -634,12 +1244,16 @@ std::array<int16_t, KNOWN_CHESS_PIECE_COUNT> ChessBoardAnalysis::chessPiecesCoun
 {
 	std::array<int16_t, KNOWN_CHESS_PIECE_COUNT> count{0};
 	
-	for(ChessBoard::BoardPosition_t pos=0, end=ChessBoard::param.cellCount; pos!=end; ++pos)
+	if(board->bitboard() || board->wideBitboard())
 	{
-		++count[board->getPiecePos(pos)]; // ChessPiece is a numerical constant
+		for(ChessPiece piece=0; piece<KNOWN_CHESS_PIECE_COUNT; ++piece)
+		{
+			count[piece] = board->bitboard() ? board->bitboard()->count(piece) : board->wideBitboard()->count(piece);
+		}
+		return count;
 	}
 	
-	return count;
+	return board->pieceList()->getCounts();
 }
 
 ChessGamePart ChessBoardAnalysis::chessGamePart(const std::array<int16_t, KNOWN_CHESS_PIECE_COUNT> &count) const
@@ -689,125 +1303,170 @@ weight_type ChessBoardAnalysis::chessPiecesWeight(const std::array<int16_t, KNOW
 
 }
 weight_type ChessBoardAnalysis::chessPieceAttackedWeight() const
+{
+	return dispatchGeometry(ChessBoard::param, [&](const auto &geometry) {
+		return this->chessPieceAttackedWeight(geometry);
+	});
+}
+template<typename Geometry>
+weight_type ChessBoardAnalysis::chessPieceAttackedWeight(const Geometry &geometry) const
 {
 	assert(board);
 	weight_type result = 0;
 	
-	ChessPiece curPiece;
-	for(ChessBoard::BoardPosition_t pos=0, end=ChessBoard::param.cellCount; pos!=end; ++pos)
+	// by who has more attacks on them: the own pieces are defended, the other ones attacked
+	auto piecesWeight = [](ChessPiece piece, weight_type whiteMore, weight_type blackMore) -> weight_type {
+		return getColour(piece)==ChessPlayerColour::WHITE ?
+			weightFromPiece(piece) * (whiteMore*PIECE_DEFENCE_MUTIPLIER - blackMore*PIECE_ATTACK_MULTIPLIER) :
+			weightFromPiece(piece) * (whiteMore*PIECE_ATTACK_MULTIPLIER - blackMore*PIECE_DEFENCE_MUTIPLIER);
+	};
+	
+	// the pieces of a kind counted in the cells each side attacks more
+	auto bitboardPieces = [&](const auto &bb) {
+		for(size_t word=0, end=geometry.wordCount(); word<end; ++word)
+		{
+			ChessAttackMap::Word_t whiteMore, blackMore;
+			attackMap.compare(geometry, word, whiteMore, blackMore);
+			if(!(wordOf(bb.getOccupied(), word) & (whiteMore | blackMore)))
+			{
+				continue;
+			}
+			for(ChessPiece piece=0; piece<KNOWN_CHESS_PIECE_COUNT; ++piece)
+			{
+				if(piece==EMPTY_CELL || !weightFromPiece(piece))
+				{
+					continue;
+				}
+				const ChessAttackMap::Word_t pieces = wordOf(bb.getPieces(piece), word);
+				result += piecesWeight(piece, bitCount(pieces & whiteMore), bitCount(pieces & blackMore));
+			}
+		}
+	};
+	if(board->bitboard())
 	{
-		// get non-empty cells
-		curPiece = board->getPiecePos(pos);
-		if(curPiece == EMPTY_CELL) continue;
-		
-		auto multiplierColour = getWeightMultiplier(getColour(curPiece));
-		auto dominator = domination( // who has more attacks -1 (black); 0 (neutral); 1 (white)
-			underAttackByWhite[pos],
-			underAttackByBlack[pos]
-			);
-		auto attackOrDefence = PIECE_ATTACK_MULTIPLIER;
-		if(multiplierColour==dominator)
+		bitboardPieces(*board->bitboard());
+	}
+	else if(board->wideBitboard())
+	{
+		bitboardPieces(*board->wideBitboard());
+	}
+	else
+	{
+		for(const auto &entry : *board->pieceList())
 		{
-			attackOrDefence = PIECE_DEFENCE_MUTIPLIER; // defending own piece
+			const int dominance = attackMap.dominance(entry.pos);
+			result += piecesWeight(entry.piece, dominance>0, dominance<0);
 		}
-		
-		result += dominator * weightFromPiece(curPiece) * attackOrDefence;
 	}
 	
 	return result;
 }
 
 weight_type ChessBoardAnalysis::chessCentreControlWeight() const
+{
+	return dispatchGeometry(ChessBoard::param, [&](const auto &geometry) {
+		return this->chessCentreControlWeight(geometry);
+	});
+}
+template<typename Geometry>
+weight_type ChessBoardAnalysis::chessCentreControlWeight(const Geometry &geometry) const
 {
 	const static weight_type CELL_WEIGHT_MULTIPLIER = 300;
-	const static weight_type CELL_WEIGHT[64]
-	{
-		3, 3, 3, 3, 3, 3, 3, 3,
-		3, 3, 3, 3, 3, 3, 3, 3,
-		2, 2, 7, 7, 7, 7, 2, 2,
-		1, 4, 6, 8, 8, 6, 4, 1,
-		1, 4, 6, 8, 8, 6, 4, 1,
-		2, 2, 7, 7, 7, 7, 2, 2,
-		3, 3, 3, 3, 3, 3, 3, 3,
-		3, 3, 3, 3, 3, 3, 3, 3
-	};
 	
-	weight_type result = 0;
-	for(ChessBoard::BoardPosition_t pos=0, end=ChessBoard::param.cellCount; pos!=end; ++pos)
+	// the cells each side attacks more, weighed a bit of the weights at a time
+	// (the sides are summed apart, the shifts stay on the non-negative counts)
+	const size_t words = geometry.wordCount();
+	weight_type white = 0, black = 0;
+	for(size_t word=0; word<words; ++word)
 	{
-		result +=
-			domination(
-				underAttackByWhite[pos],
-				underAttackByBlack[pos]
-				)
-			* CELL_WEIGHT[pos]
-			* CELL_WEIGHT_MULTIPLIER;
+		ChessAttackMap::Word_t whiteMore, blackMore;
+		attackMap.compare(geometry, word, whiteMore, blackMore);
+		for(unsigned bit=0; bit<CENTRE_WEIGHT_BITS; ++bit)
+		{
+			const ChessAttackMap::Word_t cells = centreWeights[bit*words + word];
+			white += (weight_type)bitCount(whiteMore & cells) << bit;
+			black += (weight_type)bitCount(blackMore & cells) << bit;
+		}
 	}
-	return result;
+	return (white - black) * CELL_WEIGHT_MULTIPLIER;
 }
 
+// the instantiations dispatchGeometry picks, the runtime one is also the reference for the others (see ChessBenchmark)
+template weight_type ChessBoardAnalysis::chessPieceAttackedWeight(const ChessStandardGeometry &geometry) const;
+template weight_type ChessBoardAnalysis::chessPieceAttackedWeight(const ChessCapablancaGeometry &geometry) const;
+template weight_type ChessBoardAnalysis::chessPieceAttackedWeight(const ChessRuntimeGeometry &geometry) const;
+template weight_type ChessBoardAnalysis::chessCentreControlWeight(const ChessStandardGeometry &geometry) const;
+template weight_type ChessBoardAnalysis::chessCentreControlWeight(const ChessCapablancaGeometry &geometry) const;
+template weight_type ChessBoardAnalysis::chessCentreControlWeight(const ChessRuntimeGeometry &geometry) const;
+
 weight_type ChessBoardAnalysis::chessKingPositionWeight(ChessGamePart gamePart) const
 {
-	if(gamePart==ChessGamePart::END_GAME)
-	{
-		int wh = ChessBoard::param.width - board->whiteKingPos[1];
-		int wv = ChessBoard::param.height - board->whiteKingPos[2];
-		int bh = ChessBoard::param.width - board->blackKingPos[1];
-		int bv = ChessBoard::param.height - board->blackKingPos[2];
-		wh = wh<0 ? -wh : wh;
-		wv = wv<0 ? -wv : wv;
-		bh = bh<0 ? -bh : bh;
-		bv = bv<0 ? -bv : bv;
-		
-		int wd = wh + wv;
-		int bd = bh + bv;
+	return dispatchGeometry(ChessBoard::param, [&](const auto &geometry) -> weight_type {
+		const int whiteKingFile = geometry.getFile(board->getKingPos(ChessPlayerColour::WHITE));
+		const int whiteKingRank = geometry.getRank(board->getKingPos(ChessPlayerColour::WHITE));
+		const int blackKingFile = geometry.getFile(board->getKingPos(ChessPlayerColour::BLACK));
+		const int blackKingRank = geometry.getRank(board->getKingPos(ChessPlayerColour::BLACK));
+		if(gamePart==ChessGamePart::END_GAME)
+		{
+			int wh = geometry.width() - whiteKingFile;
+			int wv = geometry.height() - whiteKingRank;
+			int bh = geometry.width() - blackKingFile;
+			int bv = geometry.height() - blackKingRank;
+			wh = wh<0 ? -wh : wh;
+			wv = wv<0 ? -wv : wv;
+			bh = bh<0 ? -bh : bh;
+			bv = bv<0 ? -bv : bv;
 		
-		return (wd - bd);
-	}
-	else//(gamePart==ChessGamePart::MID_GAME || gamePart==ChessGamePart::OPENING)
-	{
-		int res = 0;
-		const std::pair<int, int> neighbours[8] = {
-			std::pair<int, int>(-1, -1),
-			std::pair<int, int>(-1, 0),
-			std::pair<int, int>(-1, 1),
-			std::pair<int, int>(0, -1),
-			std::pair<int, int>(0, 1),
-			std::pair<int, int>(1, -1),
-			std::pair<int, int>(1, 0),
-			std::pair<int, int>(1, 1)
-		};
+			int wd = wh + wv;
+			int bd = bh + bv;
 		
-		size_t x, y;
-		for(auto p : neighbours)
+			return (wd - bd);
+		}
+		else//(gamePart==ChessGamePart::MID_GAME || gamePart==ChessGamePart::OPENING)
 		{
-			x = board->whiteKingPos[1] + p.first;
-			y = board->whiteKingPos[2] + p.second;
-			
-			if(x >= ChessBoard::param.width || y >= ChessBoard::param.height)
+			int res = 0;
+			const std::pair<int, int> neighbours[8] = {
+				std::pair<int, int>(-1, -1),
+				std::pair<int, int>(-1, 0),
+				std::pair<int, int>(-1, 1),
+				std::pair<int, int>(0, -1),
+				std::pair<int, int>(0, 1),
+				std::pair<int, int>(1, -1),
+				std::pair<int, int>(1, 0),
+				std::pair<int, int>(1, 1)
+			};
+		
+			size_t x, y;
+			for(auto p : neighbours)
 			{
-				++res;
-				continue;
-			}
+				x = whiteKingFile + p.first;
+				y = whiteKingRank + p.second;
 			
-			res+=domination(underAttackByWhite[y*ChessBoard::param.width+x], underAttackByBlack[y*ChessBoard::param.width+x]);
-		}
-		for(auto p : neighbours)
-		{
-			x = board->blackKingPos[1] + p.first;
-			y = board->blackKingPos[2] + p.second;
+				if(x >= geometry.width() || y >= geometry.height())
+				{
+					++res;
+					continue;
+				}
 			
-			if(x >= ChessBoard::param.width || y >= ChessBoard::param.height)
-			{
-				--res;
-				continue;
+				res+=attackMap.dominance(geometry.getPos(x, y));
 			}
+			for(auto p : neighbours)
+			{
+				x = blackKingFile + p.first;
+				y = blackKingRank + p.second;
 			
-			res+=domination(underAttackByWhite[y*ChessBoard::param.width+x], underAttackByBlack[y*ChessBoard::param.width+x]);
-		}
+				if(x >= geometry.width() || y >= geometry.height())
+				{
+					--res;
+					continue;
+				}
+			
+				res+=attackMap.dominance(geometry.getPos(x, y));
+			}
 		
-		return res;
-	}
+			return res;
+		}
+	});
 }
 
 bool ChessBoardAnalysis::isCheck() const
@@ -828,29 +1487,94 @@ bool ChessBoardAnalysis::isCheckMate() const
 void ChessBoardAnalysis::clearPossibleMoves(ChessBoard::ptr toKeep)
 {
 	if(!possibleMoves) return;
+	PossibleMove kept;
 	for(auto it=possibleMoves->begin(), end=possibleMoves->end(); it!=end; ++it)
 	{
-		if(*it != toKeep)
+		if(!it->board)
 		{
-			(*it)->from.reset();
-			(*it)->clearPossibleMoves();
+			continue;
+		}
+		if(it->board == toKeep)
+		{
+			kept = std::move(*it); // still a parent of it
+			continue;
+		}
+		// the boards of a frozen slab go with the slab, no need to walk them
+		if(!ChessBoardSlab::of(it->board.get()).isFrozen())
+		{
+			if(ChessPositionTable* table = ChessPositionTable::of(it->board.get()))
+			{
+				if(table->getParents(it->board.get()) > 1)
+				{
+					continue; // still searched from another parent, only this link goes (in reset)
+				}
+				table->remove(it->board.get()); // not to be handed out while it is taken apart
+			}
+			it->board->clearPossibleMoves();
+			if(it->board->refCount > 1)
+			{
+				// something still hangs from it (a shared board counting its changes from it),
+				// so it is rolled out before its own changes lose their base
+				it->board->makeIFrame();
+			}
+			it->board->resetFrom();
 		}
 	}
 	this->reset();
 	if(toKeep)
 	{
-		possibleMoves = new std::vector<ChessBoard::ptr>(1);
-		(*possibleMoves)[0]=std::move(toKeep);
-		possibleMoves->shrink_to_fit();
+		if(!kept.board)
+		{
+			kept.board = std::move(toKeep);
+		}
+		possibleMoves = new std::vector<PossibleMove>(1);
+		(*possibleMoves)[0] = std::move(kept);
 	}
 }
 
-std::vector<ChessBoard::ptr> * const ChessBoardAnalysis::getPossibleMoves() const
+std::vector<ChessBoardAnalysis::PossibleMove> * const ChessBoardAnalysis::getPossibleMoves() const
 {
 	return possibleMoves;
 }
 
+ChessBoard::ptr ChessBoardAnalysis::getPossibleMove(size_t i)
+{
+	assert(possibleMoves!=nullptr && i<possibleMoves->size());
+	PossibleMove &possibleMove = (*possibleMoves)[i];
+	if(!possibleMove.board)
+	{
+		possibleMove.board = factory.createBoard(board, possibleMove.move);
+		if(ChessFrameCache* cache = board->frameCache())
+		{
+			cache->recount(board);
+		}
+	}
+	return possibleMove.board;
+}
+
 ChessBoard::ptr ChessBoardAnalysis::getBoard() const
 {
 	return board;
 }
+
+size_t ChessBoardAnalysis::getFootprint() const
+{
+	size_t result = 0;
+	result += attackMap.getFootprint();
+	if(pendingMoves)
+	{
+		result += sizeof(*pendingMoves) + pendingMoves->capacity()*sizeof(PendingMove);
+	}
+	if(possibleMoves)
+	{
+		result += sizeof(*possibleMoves) + possibleMoves->capacity()*sizeof(PossibleMove);
+		for(auto it=possibleMoves->begin(), end=possibleMoves->end(); it!=end; ++it)
+		{
+			if(it->board)
+			{
+				result += ChessBoardSlab::BOARD_RECORD_SIZE;
+			}
+		}
+	}
+	return result;
+}
@@ -6,11 +6,15 @@
 #include "ChessBoard.hpp"
 #include "ChessMove.hpp"
 #include "ChessBoardFactory.hpp"
+#include "ChessCompactMove.hpp"
+#include "ChessRayTable.hpp"
+#include "ChessAttackMap.hpp"
 
 
 
 #include <limits>
 #include <array>
+#include <atomic>
 
 enum class ChessGamePart
 {
@@ -27,30 +31,98 @@ public:
 	static const weight_type MIN_WEIGHT=std::numeric_limits<weight_type>::min();
 	static const weight_type MAX_WEIGHT=std::numeric_limits<weight_type>::max();
 
-	static unsigned long long constructed;
+	static std::atomic<unsigned long long> constructed; // relaxed, see ChessBoard::chessBoardCount
+	
+	struct PossibleMove
+	{
+		ChessCompactMove move;
+		ChessBoard::ptr board; // nullptr until the move is searched, see getPossibleMove
+	};
 private:
-	ChessBoard::ptr board;
+	// the lines to the king of the side to move, found once per node: a move of another piece is legal
+	// when it keeps to them, so only the king's moves and en passan are made on the board to be tested
+	struct KingLines
+	{
+		struct Line
+		{
+			ChessBoard::BoardPosition_t pos; // the pinned piece, or the checker
+			ChessRayTable::iterator begin, end; // the cells from the king up to the pinner or the checker
+			
+			bool contains(ChessBoard::BoardPosition_t cell) const;
+		};
+		
+		ChessBoard::BoardPosition_t king;
+		uint8_t checkers;
+		uint8_t pinCount;
+		Line check; // the line of the only checker, to take it or to block it
+		Line pins[8]; // a pin is along a rook or a bishop line
+		
+		bool isRestricted() const; // in check or with a pinned piece
+		bool allows(ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) const; // not for the king
+	};
+	
+	ChessBoard* board; // not counted, the board owns its analysis
 	
-	std::vector<ChessBoard::ptr>* possibleMoves;
+	std::vector<PossibleMove>* possibleMoves; // the legal ones picked so far
+	// a generated move with its score, the scores are small
+	struct PendingMove
+	{
+		ChessCompactMove move;
+		int32_t score;
+	};
+	std::vector<PendingMove>* pendingMoves; // generated, the king's not tested yet: the scored ones, then the rest
+	uint32_t pendingNext; // the first not picked of pendingMoves
+	uint32_t pendingScored; // the end of the scored ones, the best of them is picked first
 	
 	bool check;
+	bool quietsPending; // the quiet moves are generated when the takes run out
+	uint8_t enPassanTakes; // counted in the attack maps on the cell of the taken pawn
 
-	int8_t *underAttackByWhite; // [rank*w+file]
-	int8_t *underAttackByBlack; // [rank*w+file]
+	ChessAttackMap attackMap; // the attacks of both sides go to the colour to move (the other one stays 0)
+	
+	static const unsigned CENTRE_WEIGHT_BITS = 4;
+	static std::vector<ChessAttackMap::Word_t> centreWeights; // [bit*words + word] - the cells whose centre weight has the bit
 	
-	void calculatePossibleMoves_common();
-	void calculatePossibleMoves_pawnfirst();
-	void calculatePossibleMoves_enpassan();
-	void calculatePossibleMoves_castling();
+	void calculateKingLines(KingLines &lines) const;
+	bool deriveAttackMaps(); // from the maps of the parent, false if it has none
+	bool isAttackMapValid() const; // compare the derived attack maps with the ones calculated from scratch (debug check)
+	enum MoveStage
+	{
+		TAKES, // the captures (the attack maps are walked with them)
+		QUIETS, // the moves to the empty cells
+		ALL_MOVES
+	};
+	void calculatePossibleMoves_common(ChessMoveList &moves, const KingLines &lines, MoveStage stage, bool maps); // maps unless derived
+	template<ChessPlayerColour turn, bool withTakes, bool withQuiets, bool withMaps>
+	void calculatePossibleMoves_common(ChessMoveList &moves, const KingLines &lines); // the visitors are made for the side to move
+	void calculatePossibleMoves_evasions(ChessMoveList &moves, const KingLines &lines); // in check, instead of the moves of the walk
+	void calculatePossibleMoves_pawnfirst(ChessMoveList &moves, const KingLines &lines);
+	void calculatePossibleMoves_enpassan(ChessMoveList &moves);
+	void calculatePossibleMoves_castling(ChessMoveList &moves);
+	// the move ordering: the captures by the most valuable victim and then the least valuable attacker (MVV-LVA),
+	// the promotions by the new piece and the moves to a cell that checks the other king get a score, the rest 0
+	static const weight_type CAPTURE_SCORE = 1024, PROMOTION_SCORE = 1024, VICTIM_SCORE = 16, CHECK_SCORE = 64;
+	void calculateCheckCells(uint8_t* cells) const; // [pos] - the lines from the other king through the cell, up to a piece
+	weight_type scoreMove(const ChessCompactMove &move, const uint8_t* checkCells) const;
+	void setPendingMoves(ChessMoveList &moves); // scores them, the scored ones first
+	void calculateQuietMoves(); // the second stage of the pending moves
+	void pickPossibleMove(); // tests the best pending move if it is the king's, adds it to possibleMoves if legal
 	
 	static ChessBoardFactory factory;
 public:
 	ChessBoardAnalysis(ChessBoard::ptr board_);
 	~ChessBoardAnalysis();
+	
+	// the analysis goes to the ChessBoardSlab of its board
+	static void* operator new(size_t size, ChessBoardSlab &slab);
+	static void operator delete(void* p, ChessBoardSlab &slab);
+	static void operator delete(void* p);
 	void reset();
+	
+	static void init(const ChessGameParameters &param); // the weights of the cells for the board geometry
 
-	bool isCheckMate() const;  // call to this function is underfined without calculatePossibleMoves()
-	bool isCheck() const; // call to this function is underfined without calculatePossibleMoves()
+	bool isCheckMate() const;  // call to this function is underfined without startPossibleMoves()
+	bool isCheck() const; // call to this function is underfined without startPossibleMoves()
 
 	std::array<int16_t, KNOWN_CHESS_PIECE_COUNT> chessPiecesCount() const;
 	
@@ -60,16 +132,29 @@ public:
 	
 	weight_type chessPieceAttackedWeight() const;
 	weight_type chessCentreControlWeight() const;
+	// the same on the board geometry (see dispatchGeometry), for ChessStandardGeometry, ChessCapablancaGeometry and ChessRuntimeGeometry:
+	// a fixed geometry has the word count of the attack maps a constant, so their loops unroll
+	template<typename Geometry> weight_type chessPieceAttackedWeight(const Geometry &geometry) const;
+	template<typename Geometry> weight_type chessCentreControlWeight(const Geometry &geometry) const;
 	
 	ChessGamePart chessGamePart(const std::array<int16_t, KNOWN_CHESS_PIECE_COUNT> &count) const;
 	weight_type chessKingPositionWeight(ChessGamePart gamePart) const;
 	
-	void calculatePossibleMoves();
-	std::vector<ChessBoard::ptr> * const getPossibleMoves() const; // call to this function is underfined without calculatePossibleMoves()
+	// the attack maps and the moves in stages: the best of the previous search stays first (see ChessEngine),
+	// then the captures (or the evasions in check) by their score, then the quiet moves, the checks first; the quiet moves
+	// are generated only when the captures run out. only the legal moves are generated, but the king's: those are tested
+	// when picked, so a cutoff saves testing the rest
+	void startPossibleMoves(); // in check picks up to the first legal move, isCheckMate() is known after it
+	bool hasPossibleMove(size_t i); // picks up to the i-th move, false if there are fewer
+	void calculatePossibleMoves(); // picks all of them
+	std::vector<PossibleMove> * const getPossibleMoves() const; // the picked ones, call to this function is underfined without startPossibleMoves()
+	ChessBoard::ptr getPossibleMove(size_t i); // the board of the i-th move, made on the first call
 	void clearPossibleMoves(ChessBoard::ptr toKeep = nullptr);
 
 	
 	ChessBoard::ptr getBoard() const;
+	
+	size_t getFootprint() const; // the bytes of the attack maps, of the moves and of the P-frames made for them
 };
 
 constexpr ChessBoardAnalysis::weight_type
@@ -87,4 +172,35 @@ constexpr ChessBoardAnalysis::weight_type
 	PIECE_PRESENT_MILTIPLIER=10
 	;
 
+inline bool ChessBoardAnalysis::KingLines::Line::contains(ChessBoard::BoardPosition_t cell) const
+{
+	for(auto it=begin; it!=end; ++it)
+	{
+		if(*it==cell)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+inline bool ChessBoardAnalysis::KingLines::isRestricted() const
+{
+	return checkers!=0 || pinCount!=0;
+}
+inline bool ChessBoardAnalysis::KingLines::allows(ChessBoard::BoardPosition_t pos, ChessBoard::BoardPosition_t newPos) const
+{
+	if(checkers>1 || (checkers==1 && !check.contains(newPos)))
+	{
+		return false; // only the king can leave a double check
+	}
+	for(uint8_t i=0; i<pinCount; ++i)
+	{
+		if(pins[i].pos==pos)
+		{
+			return pins[i].contains(newPos);
+		}
+	}
+	return true;
+}
+
 #endif
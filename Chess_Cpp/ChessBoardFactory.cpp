@@ -1,37 +1,104 @@
 #include "ChessBoardFactory.hpp"
 #include "ChessGameParameters.hpp"
+#include "ChessPositionTable.hpp"
 #include <memory>
 #include <cassert>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
 
 #include "Log.hpp"
 
 //std::vector<std::weak_ptr<ChessBoard>> ChessBoardFactory::allBoards;
 
+// the board is as wide as the widest rank, e.g. 10x8 for the Capablanca chess
+static void fenDimentions(const std::string &fen,
+	ChessGameParameters::BoardPosition_t &width, ChessGameParameters::BoardPosition_t &height,
+	bool &hasFairyPieces)
+{
+	width = 0;
+	height = 1;
+	hasFairyPieces = false;
+	
+	ChessGameParameters::BoardPosition_t file = 0, emptyCount = 0;
+	for(auto it=fen.begin(), end=fen.end(); it!=end && *it!=' '; ++it)
+	{
+		if(*it>='0' && *it<='9')
+		{
+			emptyCount = emptyCount*10 + (*it-'0');
+			continue;
+		}
+		file += emptyCount;
+		emptyCount = 0;
+		if(*it=='/')
+		{
+			width = std::max(width, file);
+			file = 0;
+			++height;
+		}
+		else
+		{
+			auto piece = charToChessPiece(*it);
+			hasFairyPieces = hasFairyPieces || piece>=PRINCESS_WHITE;
+			++file;
+		}
+	}
+	width = std::max(width, (ChessGameParameters::BoardPosition_t)(file + emptyCount));
+}
+
+ChessBoard::ptr ChessBoardFactory::createBoard()
+{
+	ChessBoard::ptr cb(new ChessBoard);
+	cb->hash = cb->calculateHash();
+	return cb;
+}
+
 	// starting position: rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1
+	// Capablanca chess: rncbqkbenr/pppppppppp/10/10/10/10/PPPPPPPPPP/RNCBQKBENR w KQkq - 0 1
 ChessBoard::ptr ChessBoardFactory::createBoard(std::string fen)
 {
-	ChessBoard::param.setDimentions(8, 8);
-	ChessBoard::param.possiblePieces = STANDARD_GAME_PIECES;
+	ChessGameParameters::BoardPosition_t width, height;
+	bool hasFairyPieces;
+	fenDimentions(fen, width, height, hasFairyPieces);
+	// a change keeps the cell in 11 bits, the bigger boards don't fit it
+	if((size_t)width*height > ChessBoardChange::MAX_CELL_COUNT)
+	{
+		throw std::invalid_argument("the board of the fen is too big: " + std::to_string(width) + "x" + std::to_string(height));
+	}
+	
+	ChessBoard::param.setDimentions(width, height);
+	ChessBoard::param.possiblePieces = hasFairyPieces ? CAPABLANCA_GAME_PIECES : STANDARD_GAME_PIECES;
 	
 	ChessBoard::ptr cb(new ChessBoard);
 	
 	bool hadBlackKing = false;
 	bool hadWhiteKing = false;
+	std::string castling, enPassan; // the fields after the side to move, empty if the fen hasn't them
 	
-	size_t file=0, rank=7;
+	size_t file=0, rank=height-1, emptyCount=0;
 	for(auto it=fen.begin(), end=fen.end(); it!=end; ++it)
 	{
+		if(*it>='0' && *it<='9')
+		{
+			emptyCount = emptyCount*10 + (*it-'0');
+			continue;
+		}
+		file += emptyCount;
+		emptyCount = 0;
+		
 		if(*it==' ')
 		{
 			++it;
 			if(*it=='w')
 			{
-				cb->turn=ChessPlayerColour::WHITE;
+				cb->state.turn=toArrayPosition(ChessPlayerColour::WHITE);
 			}
 			else
 			{
-				cb->turn=ChessPlayerColour::BLACK;
+				cb->state.turn=toArrayPosition(ChessPlayerColour::BLACK);
 			}
+			std::istringstream fields(std::string(it+1, end));
+			fields >> castling >> enPassan;
 			break;
 		}
 		else if(*it=='/')
@@ -40,44 +107,82 @@ ChessBoard::ptr ChessBoardFactory::createBoard(std::string fen)
 			--rank;
 			continue;
 		}
-		if(*it>='1' && *it<='9')
-		{
-			file+=*it-'0';
-		}
 		else
 		{
 			auto piece = charToChessPiece(*it);
 			auto pos = cb->getPos(file, rank);
-			cb->board[pos] = piece;
+			cb->setCell(pos, piece);
 			
 			// TODO: find how to realise this in FEN to make random chess work
+			// the outermost rooks castle: the first one on the left of the king, the last one on the right
 			if(piece==ROOK_WHITE && rank==0)
 			{
-				cb->whiteCastling[ hadWhiteKing ? 1 : 0 ] = pos;
+				auto &rook = ChessBoard::param.castling[toArrayPosition(ChessPlayerColour::WHITE)][ hadWhiteKing ? 1 : 0 ];
+				if(hadWhiteKing || rook==ChessBoard::param.cellCount)
+				{
+					rook = pos;
+				}
+				cb->state.castling |= 1 << (hadWhiteKing ? 1 : 0);
 			}
 			else if(piece==KING_WHITE)
 			{
 				hadWhiteKing = true;
-				cb->whiteKingPos[0] = pos;
-				cb->whiteKingPos[1] = pos % ChessBoard::param.width;
-				cb->whiteKingPos[2] = pos / ChessBoard::param.width;
+				cb->setKingPos(ChessPlayerColour::WHITE, pos);
 			}
-			else if(piece==ROOK_BLACK && rank==7)
+			else if(piece==ROOK_BLACK && rank==height-1u)
 			{
-				cb->blackCastling[ hadBlackKing ? 1 : 0 ] = pos;
+				auto &rook = ChessBoard::param.castling[toArrayPosition(ChessPlayerColour::BLACK)][ hadBlackKing ? 1 : 0 ];
+				if(hadBlackKing || rook==ChessBoard::param.cellCount)
+				{
+					rook = pos;
+				}
+				cb->state.castling |= 1 << (2 + (hadBlackKing ? 1 : 0));
 			}
 			else if(piece==KING_BLACK)
 			{
 				hadBlackKing = true;
-				cb->blackKingPos[0] = pos;
-				cb->blackKingPos[1] = pos % ChessBoard::param.width;
-				cb->blackKingPos[2] = pos / ChessBoard::param.width;
+				cb->setKingPos(ChessPlayerColour::BLACK, pos);
 			}
 			++file;
 		}
 	}
 	
+	// without the rights every rook found above may castle
+	if(!castling.empty())
+	{
+		const unsigned found = cb->state.castling;
+		cb->state.castling = 0;
+		for(char c : castling)
+		{
+			switch(c)
+			{
+				case 'Q': cb->state.castling |= 1 << 0; break;
+				case 'K': cb->state.castling |= 1 << 1; break;
+				case 'q': cb->state.castling |= 1 << 2; break;
+				case 'k': cb->state.castling |= 1 << 3; break;
+			}
+		}
+		cb->state.castling &= found;
+	}
+	// en passan is read from the changes of the board, so they are made up as the double step over the cell
+	// (as ChessPositionCodec::decode does)
+	if(enPassan.size()>=2 && enPassan[0]>='a')
+	{
+		const auto cell = cb->getPos(enPassan[0]-'a', std::stoul(enPassan.substr(1))-1);
+		const auto step = ChessBoard::param.width;
+		const bool whiteHasMoved = cb->getTurn()==ChessPlayerColour::BLACK;
+		const ChessBoard::BoardPosition_t pawnFrom = whiteHasMoved ? cell - step : cell + step;
+		const ChessBoard::BoardPosition_t pawnTo = whiteHasMoved ? cell + step : cell - step;
+		if(cell < ChessBoard::param.cellCount && pawnFrom < ChessBoard::param.cellCount && pawnTo < ChessBoard::param.cellCount)
+		{
+			cb->changes[0] = ChessBoardChange(pawnFrom, EMPTY_CELL);
+			cb->changes[1] = ChessBoardChange(pawnTo, cb->getPiecePos(pawnTo));
+			cb->state.enPassan = 1;
+		}
+	}
+	
 	cb->moveNum=0;
+	cb->hash = cb->calculateHash();
 	
 	//allBoards.push_back(cb);
 		
@@ -90,7 +195,7 @@ ChessBoard::ptr ChessBoardFactory::createBoard
 	auto tmp = new ChessBoard(fromBoard);
 	ChessBoard::ptr toBoard(tmp);
 	
-	toBoard->turn=!fromBoard->turn;
+	toBoard->setTurn(!fromBoard->getTurn());
 	toBoard->moveNum=fromBoard->moveNum+1;
 	
 	assert(fromBoard->getTurn()!=toBoard->getTurn());
@@ -113,41 +218,40 @@ ChessBoard::ptr ChessBoardFactory::createBoard
 	if(piece==KING_WHITE)
 	{
 		// change king's position
-		toBoard->whiteKingPos[0]=posTo;
-		toBoard->whiteKingPos[1]=posTo % ChessBoard::param.width;
-		toBoard->whiteKingPos[2]=posTo / ChessBoard::param.width;
+		toBoard->setKingPos(ChessPlayerColour::WHITE, posTo);
 		
 		// disallow castling both sides
-		toBoard->whiteCastling[0] = toBoard->whiteCastling[1] = ChessBoard::param.cellCount;
+		toBoard->disallowCastling(ChessPlayerColour::WHITE, 0);
+		toBoard->disallowCastling(ChessPlayerColour::WHITE, 1);
 	}
 	else if(piece==KING_BLACK)
 	{
 		// change king's position
-		toBoard->blackKingPos[0]=posTo;
-		toBoard->blackKingPos[1]=posTo % ChessBoard::param.width;
-		toBoard->blackKingPos[2]=posTo / ChessBoard::param.width;
+		toBoard->setKingPos(ChessPlayerColour::BLACK, posTo);
 		
 		// disallow castling both sides
-		toBoard->blackCastling[0] = toBoard->blackCastling[1] = ChessBoard::param.cellCount;
+		toBoard->disallowCastling(ChessPlayerColour::BLACK, 0);
+		toBoard->disallowCastling(ChessPlayerColour::BLACK, 1);
 	}
 	
 	// if one of the rooks, that could castle, has moved, disallow castling with it
 	// if one of the rooks, that could castle, was captured, disallow castling with it
-	if(posFrom == toBoard->whiteCastling[0] || posTo == toBoard->whiteCastling[0])
+	// (both can happen at once, a rook taking a rook)
+	if(posFrom == toBoard->getCastling(ChessPlayerColour::WHITE, 0) || posTo == toBoard->getCastling(ChessPlayerColour::WHITE, 0))
 	{
-		toBoard->whiteCastling[0] = ChessBoard::param.cellCount;
+		toBoard->disallowCastling(ChessPlayerColour::WHITE, 0);
 	}
-	else if(posFrom == toBoard->whiteCastling[1] || posTo == toBoard->whiteCastling[1]) 
+	if(posFrom == toBoard->getCastling(ChessPlayerColour::WHITE, 1) || posTo == toBoard->getCastling(ChessPlayerColour::WHITE, 1)) 
 	{
-		toBoard->whiteCastling[1] = ChessBoard::param.cellCount;
+		toBoard->disallowCastling(ChessPlayerColour::WHITE, 1);
 	}
-	else if(posFrom == toBoard->blackCastling[0] || posTo == toBoard->blackCastling[0])
+	if(posFrom == toBoard->getCastling(ChessPlayerColour::BLACK, 0) || posTo == toBoard->getCastling(ChessPlayerColour::BLACK, 0))
 	{
-		toBoard->blackCastling[0] = ChessBoard::param.cellCount;
+		toBoard->disallowCastling(ChessPlayerColour::BLACK, 0);
 	}
-	else if(posFrom == toBoard->blackCastling[1] || posTo == toBoard->blackCastling[1])
+	if(posFrom == toBoard->getCastling(ChessPlayerColour::BLACK, 1) || posTo == toBoard->getCastling(ChessPlayerColour::BLACK, 1))
 	{
-		toBoard->blackCastling[1] = ChessBoard::param.cellCount;
+		toBoard->disallowCastling(ChessPlayerColour::BLACK, 1);
 	}
 	
 	return toBoard;
@@ -172,43 +276,80 @@ ChessBoard::ptr ChessBoardFactory::createBoard
 	if(piece1==KING_WHITE)
 	{
 		// change king's position
-		toBoard->whiteKingPos[0]=posTo1;
-		toBoard->whiteKingPos[1]=posTo1 % ChessBoard::param.width;
-		toBoard->whiteKingPos[2]=posTo1 / ChessBoard::param.width;
+		toBoard->setKingPos(ChessPlayerColour::WHITE, posTo1);
 		
 		// disallow castling both sides
-		toBoard->whiteCastling[0] = toBoard->whiteCastling[1] = ChessBoard::param.cellCount;
+		toBoard->disallowCastling(ChessPlayerColour::WHITE, 0);
+		toBoard->disallowCastling(ChessPlayerColour::WHITE, 1);
 	}
 	else if(piece2==KING_WHITE)
 	{
 		// change king's position
-		toBoard->whiteKingPos[0]=posTo2;
-		toBoard->whiteKingPos[1]=posTo2 % ChessBoard::param.width;
-		toBoard->whiteKingPos[2]=posTo2 / ChessBoard::param.width;
+		toBoard->setKingPos(ChessPlayerColour::WHITE, posTo2);
 		
 		// disallow castling both sides
-		toBoard->whiteCastling[0] = toBoard->whiteCastling[1] = ChessBoard::param.cellCount;
+		toBoard->disallowCastling(ChessPlayerColour::WHITE, 0);
+		toBoard->disallowCastling(ChessPlayerColour::WHITE, 1);
 	}
 	else if(piece1==KING_BLACK)
 	{
 		// change king's position
-		toBoard->blackKingPos[0]=posTo1;
-		toBoard->blackKingPos[1]=posTo1 % ChessBoard::param.width;
-		toBoard->blackKingPos[2]=posTo1 / ChessBoard::param.width;
+		toBoard->setKingPos(ChessPlayerColour::BLACK, posTo1);
 		
 		// disallow castling both sides
-		toBoard->blackCastling[0] = toBoard->blackCastling[1] = ChessBoard::param.cellCount;
+		toBoard->disallowCastling(ChessPlayerColour::BLACK, 0);
+		toBoard->disallowCastling(ChessPlayerColour::BLACK, 1);
 	}
 	else if(piece2==KING_BLACK)
 	{
 		// change king's position
-		toBoard->blackKingPos[0]=posTo2;
-		toBoard->blackKingPos[1]=posTo2 % ChessBoard::param.width;
-		toBoard->blackKingPos[2]=posTo2 / ChessBoard::param.width;
+		toBoard->setKingPos(ChessPlayerColour::BLACK, posTo2);
 		
 		// disallow castling both sides
-		toBoard->blackCastling[0] = toBoard->blackCastling[1] = ChessBoard::param.cellCount;
+		toBoard->disallowCastling(ChessPlayerColour::BLACK, 0);
+		toBoard->disallowCastling(ChessPlayerColour::BLACK, 1);
 	}
 
 	return toBoard;
-}
\ No newline at end of file
+}
+
+ChessBoard::ptr ChessBoardFactory::createBoard
+  (const ChessBoard::ptr &fromBoard, const ChessCompactMove &move)
+{
+	ChessBoard::ptr toBoard;
+	if(move.kind==ChessCompactMove::CASTLING)
+	{
+		toBoard = this->createBoard(fromBoard,
+			move.from, move.to, // move king
+			move.getRookFrom(ChessBoard::param, fromBoard->getTurn()), move.getRookTo() // move rook
+			);
+	}
+	else
+	{
+		toBoard = this->createBoard(fromBoard, move.from, move.to);
+		if(move.kind==ChessCompactMove::DOUBLE_PUSH)
+		{
+			toBoard->setEnPassan((move.from + move.to) / 2);
+		}
+		else if(move.kind==ChessCompactMove::EN_PASSAN)
+		{
+			toBoard->placePiecePos(move.getTaken(ChessBoard::param), EMPTY_CELL);
+		}
+		if(move.promotion!=EMPTY_CELL)
+		{
+			toBoard->placePiecePos(move.to, move.promotion);
+		}
+	}
+	
+	// a transposition of a board alive in the search is handed out again, with its subtree
+	if(ChessPositionTable* table = toBoard->positionTable())
+	{
+		if(ChessBoard* same = table->find(*toBoard))
+		{
+			table->addParent(same);
+			return same;
+		}
+		table->insert(toBoard.get());
+	}
+	return toBoard;
+}
@@ -5,6 +5,7 @@
 
 #include "ChessBoard.hpp"
 #include "ChessMove.hpp"
+#include "ChessCompactMove.hpp"
 #include <string>
 #include <vector>
 
@@ -13,7 +14,7 @@ class ChessBoardFactory
 	ChessBoard::ptr createBoard(const ChessBoard::ptr &fromBoard);
 public:
 	//static std::vector<std::weak_ptr<ChessBoard>> allBoards;
-	ChessBoard::ptr createBoard();
+	ChessBoard::ptr createBoard(); // an empty root I-frame of the current ChessBoard::param
 	ChessBoard::ptr createBoard(std::string fen);
 	ChessBoard::ptr createBoard(
 		const ChessBoard::ptr &fromBoard,
@@ -22,6 +23,9 @@ public:
 		const ChessBoard::ptr &fromBoard,
 		const size_t &posFrom1, const size_t &posTo1,
 		const size_t &posFrom2, const size_t &posTo2);
+	ChessBoard::ptr createBoard(
+		const ChessBoard::ptr &fromBoard,
+		const ChessCompactMove &move);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef CHESSBOARDGEOMETRY__
+#define CHESSBOARDGEOMETRY__
+
+#include "config.hpp"
+
+#include <cstddef>
+
+#include "ChessGameParameters.hpp"
+
+// the board dimensions as compile time constants, so the kernels instantiated on them
+// get every '/ width' and '% width' folded into the shifts and the multiplications;
+// only the evaluation's loops use it, the move generation stays generic: the bitboard walks
+// read the precomputed tables, and getPos and ChessBoardIterator are kept off the hot paths
+template<ChessGameParameters::BoardPosition_t W, ChessGameParameters::BoardPosition_t H>
+struct ChessBoardGeometry
+{
+	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+
+	static constexpr BoardPosition_t width() { return W; }
+	static constexpr BoardPosition_t height() { return H; }
+	static constexpr BoardPosition_t cellCount() { return W*H; }
+	static constexpr size_t wordCount() { return (W*H + 63) / 64; } // of a set of the cells, as ChessAttackMap keeps them
+
+	static constexpr BoardPosition_t getPos(BoardPosition_t file, BoardPosition_t rank) { return rank*W+file; }
+	static constexpr BoardPosition_t getFile(BoardPosition_t pos) { return pos % W; }
+	static constexpr BoardPosition_t getRank(BoardPosition_t pos) { return pos / W; }
+};
+
+// any other board, the same interface over ChessGameParameters
+struct ChessRuntimeGeometry
+{
+	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+
+	const ChessGameParameters &param;
+
+	ChessRuntimeGeometry(const ChessGameParameters &param_)
+		: param(param_)
+	{}
+
+	BoardPosition_t width() const { return param.width; }
+	BoardPosition_t height() const { return param.height; }
+	BoardPosition_t cellCount() const { return param.cellCount; }
+	size_t wordCount() const { return (param.cellCount + 63) / 64; }
+
+	BoardPosition_t getPos(BoardPosition_t file, BoardPosition_t rank) const { return rank*param.width+file; }
+	BoardPosition_t getFile(BoardPosition_t pos) const { return pos % param.width; }
+	BoardPosition_t getRank(BoardPosition_t pos) const { return pos / param.width; }
+};
+
+typedef ChessBoardGeometry<8, 8> ChessStandardGeometry;
+typedef ChessBoardGeometry<10, 8> ChessCapablancaGeometry;
+
+// calls kernel(geometry) with the instantiation for the board of param:
+// the kernel is a generic lambda (or a functor with a template operator()), instantiated for every geometry
+template<typename Kernel>
+auto dispatchGeometry(const ChessGameParameters &param, Kernel &&kernel)
+	-> decltype(kernel(ChessRuntimeGeometry(param)))
+{
+	if(param.width==8 && param.height==8)
+	{
+		return kernel(ChessStandardGeometry());
+	}
+	if(param.width==10 && param.height==8)
+	{
+		return kernel(ChessCapablancaGeometry());
+	}
+	return kernel(ChessRuntimeGeometry(param));
+}
+
+#endif
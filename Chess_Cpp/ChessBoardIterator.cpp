@@ -21,10 +21,10 @@ ChessBoardConstIterator ChessBoard::end() const
 }
 
 ChessBoardIterator::ChessBoardIterator(ChessBoard* cb_, size_t boardWidth_, size_t pos_)
-	: pos(pos_), cb(cb_), curPiece(cb_->board + pos_), boardWidth(boardWidth_)
+	: pos(pos_), cb(cb_), curPiece(cb_->cells() + pos_), boardWidth(boardWidth_)
 {}
 ChessBoardConstIterator::ChessBoardConstIterator(const ChessBoard* cb_, size_t boardWidth_, size_t pos_)
-	: pos(pos_), cb(cb_), curPiece(cb_->board + pos_), boardWidth(boardWidth_)
+	: pos(pos_), cb(cb_), curPiece(cb_->cells() + pos_), boardWidth(boardWidth_)
 {}
 
 bool ChessBoardIterator::operator!=(const ChessBoardIterator& that)
@@ -0,0 +1,305 @@
+#include "ChessBoardSlab.hpp"
+#include "ChessBoard.hpp"
+#include "ChessBoardAnalysis.hpp"
+
+#include <new>
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// helper
+
+static void* allocateAligned(size_t size, size_t alignment)
+{
+#ifdef _MSC_VER
+	void* memory = _aligned_malloc(size, alignment);
+#else
+	void* memory = nullptr;
+	if(posix_memalign(&memory, alignment, size) != 0)
+	{
+		memory = nullptr;
+	}
+#endif
+	if(!memory)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+static void freeAligned(void* memory)
+{
+#ifdef _MSC_VER
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+// static data members
+
+const ChessBoardSlab::Index_t ChessBoardSlab::NULL_INDEX;
+const size_t ChessBoardSlab::CHUNK_SIZE;
+const size_t ChessBoardSlab::RECORD_ALIGNMENT;
+const size_t ChessBoardSlab::OFFSET_BITS;
+const size_t ChessBoardSlab::MAX_CHUNK_COUNT;
+const size_t ChessBoardSlab::MIN_RECORD_SIZE;
+
+const size_t ChessBoardSlab::BOARD_RECORD_SIZE =
+	(std::max(sizeof(ChessBoard), MIN_RECORD_SIZE) + RECORD_ALIGNMENT-1) & ~(RECORD_ALIGNMENT-1);
+const size_t ChessBoardSlab::RECORD_SIZE =
+	(std::max(std::max(sizeof(ChessBoardExtra), sizeof(ChessBoardAnalysis)), MIN_RECORD_SIZE)
+		+ RECORD_ALIGNMENT-1) & ~(RECORD_ALIGNMENT-1);
+const size_t ChessBoardSlab::HEADER_SIZE = (sizeof(Chunk) + RECORD_ALIGNMENT-1) & ~(RECORD_ALIGNMENT-1);
+const size_t ChessBoardSlab::RECORD_SIZES[KIND_COUNT] = { BOARD_RECORD_SIZE, RECORD_SIZE };
+const size_t ChessBoardSlab::RECORDS_PER_CHUNK[KIND_COUNT] =
+	{ (CHUNK_SIZE - HEADER_SIZE) / BOARD_RECORD_SIZE, (CHUNK_SIZE - HEADER_SIZE) / RECORD_SIZE };
+
+std::mutex ChessBoardSlab::chunkTableMutex;
+ChessBoardSlab::Chunk* ChessBoardSlab::chunkTable[MAX_CHUNK_COUNT];
+std::vector<ChessBoardSlab::Index_t> ChessBoardSlab::freeChunkIds;
+ChessBoardSlab::Index_t ChessBoardSlab::nextChunkId = 1;
+
+ChessBoardSlab* ChessBoardSlab::defaultInstance = nullptr;
+
+// class functions
+
+ChessBoardSlab::ChessBoardSlab()
+	: liveRecords(0), chunkCount(0), frozen(false), frameCache(nullptr), positionTable(nullptr)
+{
+	for(auto &r : records)
+	{
+		r.chunks = nullptr;
+		r.freeRecords = nullptr;
+	}
+}
+
+ChessBoardSlab::~ChessBoardSlab()
+{
+	release();
+}
+
+size_t ChessBoardSlab::indexOf(const Chunk* chunk, const void* record)
+{
+	return (static_cast<const char*>(record) - recordAt(const_cast<Chunk*>(chunk), 0)) / RECORD_SIZES[chunk->kind];
+}
+
+char* ChessBoardSlab::recordAt(Chunk* chunk, size_t index)
+{
+	return reinterpret_cast<char*>(chunk) + HEADER_SIZE + index*RECORD_SIZES[chunk->kind];
+}
+
+ChessBoardSlab::Chunk* ChessBoardSlab::newChunk(Kind kind)
+{
+	assert(RECORDS_PER_CHUNK[kind] <= sizeof(Chunk::boards)*8);
+	
+	Chunk* chunk = static_cast<Chunk*>(allocateAligned(CHUNK_SIZE, CHUNK_SIZE));
+	{
+		std::lock_guard<std::mutex> lock(chunkTableMutex);
+		if(!freeChunkIds.empty())
+		{
+			chunk->id = freeChunkIds.back();
+			freeChunkIds.pop_back();
+		}
+		else if(nextChunkId < MAX_CHUNK_COUNT)
+		{
+			chunk->id = nextChunkId++;
+		}
+		else
+		{
+			freeAligned(chunk);
+			throw std::bad_alloc();
+		}
+		chunkTable[chunk->id] = chunk;
+	}
+	chunk->slab = this;
+	chunk->kind = kind;
+	chunk->used = 0;
+	std::fill(chunk->boards, chunk->boards+sizeof(chunk->boards)/sizeof(chunk->boards[0]), 0);
+	
+	chunk->next = records[kind].chunks;
+	records[kind].chunks = chunk;
+	++chunkCount;
+	return chunk;
+}
+
+void* ChessBoardSlab::allocateRecord(Kind kind)
+{
+	assert(!frozen);
+	
+	Records &r = records[kind];
+	if(r.freeRecords)
+	{
+		FreeRecord* record = r.freeRecords;
+		r.freeRecords = record->next;
+		++liveRecords;
+		return record;
+	}
+	Chunk* chunk = r.chunks;
+	if(!chunk || chunk->used==RECORDS_PER_CHUNK[kind])
+	{
+		chunk = newChunk(kind);
+	}
+	++liveRecords;
+	return recordAt(chunk, chunk->used++);
+}
+
+void* ChessBoardSlab::allocate(size_t size)
+{
+	assert(size <= RECORD_SIZE);
+	return allocateRecord(OTHER);
+}
+
+void ChessBoardSlab::deallocate(void* record)
+{
+	Chunk* chunk = chunkOf(record);
+	ChessBoardSlab &slab = *chunk->slab;
+	--slab.liveRecords;
+	if(slab.frozen)
+	{
+		return; // the chunks are about to go, the free list is no more needed
+	}
+	Records &r = slab.records[chunk->kind];
+	FreeRecord* free = static_cast<FreeRecord*>(record);
+	free->next = r.freeRecords;
+	r.freeRecords = free;
+}
+
+void* ChessBoardSlab::allocateBoard(size_t size)
+{
+	assert(size <= BOARD_RECORD_SIZE);
+	void* record = allocateRecord(BOARD);
+	Chunk* chunk = chunkOf(record);
+	const size_t index = indexOf(chunk, record);
+	chunk->boards[index/64] |= uint64_t(1) << (index%64);
+	return record;
+}
+
+void ChessBoardSlab::deallocateBoard(void* record)
+{
+	Chunk* chunk = chunkOf(record);
+	const size_t index = indexOf(chunk, record);
+	chunk->boards[index/64] &= ~(uint64_t(1) << (index%64));
+	deallocate(record);
+}
+
+ChessBoardSlab& ChessBoardSlab::of(const void* record)
+{
+	return *chunkOf(record)->slab;
+}
+
+bool ChessBoardSlab::owns(const void* record) const
+{
+	return chunkOf(record)->slab == this;
+}
+
+ChessBoardSlab*& ChessBoardSlab::threadCurrent()
+{
+	thread_local ChessBoardSlab* current = nullptr;
+	return current;
+}
+
+ChessBoardSlab& ChessBoardSlab::current()
+{
+	ChessBoardSlab* slab = threadCurrent();
+	if(slab)
+	{
+		return *slab;
+	}
+	if(!defaultInstance)
+	{
+		defaultInstance = new ChessBoardSlab;
+	}
+	return *defaultInstance;
+}
+
+ChessBoardSlab::Scope::Scope(ChessBoardSlab &slab)
+	: previous(threadCurrent())
+{
+	threadCurrent() = &slab;
+}
+
+ChessBoardSlab::Scope::~Scope()
+{
+	threadCurrent() = previous;
+}
+
+void ChessBoardSlab::freeze()
+{
+	frozen = true;
+}
+
+bool ChessBoardSlab::isFrozen() const
+{
+	return frozen;
+}
+
+void ChessBoardSlab::release()
+{
+	frozen = true;
+	
+	// the extras and the analyses go with their boards. while frozen, a destroyed board does not touch
+	// the other boards of the slab (see intrusivePtrRelease, getPositionTable, getFrameCache), they may be gone already
+	for(Chunk* chunk = records[BOARD].chunks; chunk; chunk = chunk->next)
+	{
+		for(size_t word=0, wordEnd=(chunk->used+63)/64; word<wordEnd; ++word)
+		{
+			while(chunk->boards[word])
+			{
+				const size_t index = word*64 + bitScanForward(chunk->boards[word]);
+				delete reinterpret_cast<ChessBoard*>(recordAt(chunk, index));
+			}
+		}
+	}
+	assert(liveRecords==0);
+	
+	std::lock_guard<std::mutex> lock(chunkTableMutex);
+	for(auto &r : records)
+	{
+		while(r.chunks)
+		{
+			Chunk* next = r.chunks->next;
+			chunkTable[r.chunks->id] = nullptr;
+			freeChunkIds.push_back(r.chunks->id);
+			freeAligned(r.chunks);
+			r.chunks = next;
+		}
+		r.freeRecords = nullptr;
+	}
+	chunkCount = 0;
+	liveRecords = 0;
+	frozen = false;
+}
+
+void ChessBoardSlab::setFrameCache(ChessFrameCache* cache)
+{
+	frameCache = cache;
+}
+
+ChessFrameCache* ChessBoardSlab::getFrameCache() const
+{
+	return frozen ? nullptr : frameCache;
+}
+
+void ChessBoardSlab::setPositionTable(ChessPositionTable* table)
+{
+	positionTable = table;
+}
+
+ChessPositionTable* ChessBoardSlab::getPositionTable() const
+{
+	return frozen ? nullptr : positionTable;
+}
+
+size_t ChessBoardSlab::getLiveRecords() const
+{
+	return liveRecords;
+}
+
+size_t ChessBoardSlab::getChunkCount() const
+{
+	return chunkCount;
+}
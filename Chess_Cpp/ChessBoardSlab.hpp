@@ -0,0 +1,154 @@
+#ifndef CHESSBOARDSLAB__
+#define CHESSBOARDSLAB__
+
+#include "config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class ChessBoard;
+class ChessFrameCache;
+class ChessPositionTable;
+
+// fixed size records for the ChessBoard nodes and for their ChessBoardExtra and ChessBoardAnalysis objects,
+// carved out of the big aligned chunks, so a record finds its slab by masking its address.
+// a record can also be named by a 32-bit Index_t, which is how the boards refer to each other.
+// a slab is used by one thread at a time (the search that owns it)
+class ChessBoardSlab
+{
+public:
+	typedef uint32_t Index_t; // chunk id in the high bits, offset in the chunk in the low ones
+
+	static const Index_t NULL_INDEX = 0;
+	static const size_t CHUNK_SIZE = 64*1024; // also the alignment of the chunks
+	static const size_t BOARD_RECORD_SIZE; // a ChessBoard
+	static const size_t RECORD_SIZE; // a ChessBoardExtra or a ChessBoardAnalysis
+private:
+	static const size_t RECORD_ALIGNMENT = 8;
+	static const size_t OFFSET_BITS = 13; // CHUNK_SIZE/RECORD_ALIGNMENT
+	static const size_t MAX_CHUNK_COUNT = 1 << 16; // 4 Gb of the records for all the slabs
+	static const size_t MIN_RECORD_SIZE = 16;
+
+	enum Kind
+	{
+		BOARD, // the live ones are marked, for release()
+		OTHER,
+		KIND_COUNT
+	};
+	struct Chunk
+	{
+		ChessBoardSlab* slab;
+		Chunk* next;
+		Index_t id;
+		Kind kind;
+		size_t used; // records carved so far
+		uint64_t boards[CHUNK_SIZE/MIN_RECORD_SIZE/64]; // bit per record, set for the live ChessBoard-s
+	};
+	struct FreeRecord // lives in the unused record itself
+	{
+		FreeRecord* next;
+	};
+	struct Records
+	{
+		Chunk* chunks; // the newest first
+		FreeRecord* freeRecords;
+	};
+	static const size_t HEADER_SIZE; // the Chunk, rounded up to RECORD_ALIGNMENT
+	static const size_t RECORD_SIZES[KIND_COUNT];
+	static const size_t RECORDS_PER_CHUNK[KIND_COUNT];
+
+	static std::mutex chunkTableMutex; // guards the ids, the readers of chunkTable don't need it
+	static Chunk* chunkTable[MAX_CHUNK_COUNT]; // [id]
+	static std::vector<Index_t> freeChunkIds;
+	static Index_t nextChunkId; // 0 is never used, so NULL_INDEX names nothing
+
+	Records records[KIND_COUNT];
+	size_t liveRecords;
+	size_t chunkCount;
+	bool frozen;
+	ChessFrameCache* frameCache; // the memory budget of the search, if any
+	ChessPositionTable* positionTable; // the shared transpositions of the search, if any
+
+	static Chunk* chunkOf(const void* record);
+	static size_t indexOf(const Chunk* chunk, const void* record);
+	static char* recordAt(Chunk* chunk, size_t index);
+
+	void* allocateRecord(Kind kind);
+	Chunk* newChunk(Kind kind);
+
+	static ChessBoardSlab* defaultInstance; // for the boards made outside of any search, never released
+	static ChessBoardSlab*& threadCurrent();
+public:
+	ChessBoardSlab();
+	ChessBoardSlab(const ChessBoardSlab &that) = delete;
+	ChessBoardSlab& operator=(const ChessBoardSlab &that) = delete;
+	~ChessBoardSlab(); // release()
+
+	void* allocate(size_t size);
+	static void deallocate(void* record); // into the slab it came from
+
+	// ChessBoard's operator new/delete keep the list of the live boards for release()
+	void* allocateBoard(size_t size);
+	static void deallocateBoard(void* record);
+
+	static Index_t toIndex(const void* record); // NULL_INDEX for nullptr
+	static void* fromIndex(Index_t index); // nullptr for NULL_INDEX
+
+	static ChessBoardSlab& of(const void* record);
+	bool owns(const void* record) const;
+
+	static ChessBoardSlab& current(); // where the new boards of this thread go
+
+	// makes the current slab of this thread, while the object lives
+	class Scope
+	{
+		ChessBoardSlab* previous;
+	public:
+		Scope(ChessBoardSlab &slab);
+		~Scope();
+	};
+
+	// the bulk release of a whole search tree:
+	// freeze() stops the reference counting from destroying the boards of this slab,
+	// so the handles from outside can be dropped without walking the tree,
+	// release() then destroys whatever is alive chunk by chunk, without following the links, and frees the chunks
+	void freeze();
+	bool isFrozen() const;
+	void release();
+
+	void setFrameCache(ChessFrameCache* cache);
+	ChessFrameCache* getFrameCache() const; // nullptr while frozen
+	void setPositionTable(ChessPositionTable* table);
+	ChessPositionTable* getPositionTable() const; // nullptr while frozen
+
+	size_t getLiveRecords() const;
+	size_t getChunkCount() const;
+};
+
+inline ChessBoardSlab::Index_t ChessBoardSlab::toIndex(const void* record)
+{
+	if(!record)
+	{
+		return NULL_INDEX;
+	}
+	const Chunk* chunk = chunkOf(record);
+	return (chunk->id << OFFSET_BITS) |
+		(Index_t)((reinterpret_cast<uintptr_t>(record) & (CHUNK_SIZE-1)) / RECORD_ALIGNMENT);
+}
+inline void* ChessBoardSlab::fromIndex(Index_t index)
+{
+	if(index==NULL_INDEX)
+	{
+		return nullptr;
+	}
+	return reinterpret_cast<char*>(chunkTable[index >> OFFSET_BITS])
+		+ (index & ((1 << OFFSET_BITS)-1)) * RECORD_ALIGNMENT;
+}
+inline ChessBoardSlab::Chunk* ChessBoardSlab::chunkOf(const void* record)
+{
+	return reinterpret_cast<Chunk*>(reinterpret_cast<uintptr_t>(record) & ~(uintptr_t)(CHUNK_SIZE-1));
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include "ChessCellArrayPool.hpp"
+
+#include <new>
+#include <cassert>
+
+// static data members
+
+const size_t ChessCellArrayPool::MIN_BLOCK_SIZE;
+const size_t ChessCellArrayPool::SIZE_CLASS_COUNT;
+const size_t ChessCellArrayPool::BATCH_SIZE;
+
+std::mutex ChessCellArrayPool::globalMutex;
+ChessCellArrayPool::FreeList ChessCellArrayPool::globalLists[SIZE_CLASS_COUNT];
+ChessCellArrayPool::Statistics ChessCellArrayPool::globalStatistics = { 0, 0, 0, 0 };
+
+// class functions
+
+void ChessCellArrayPool::FreeList::push(FreeBlock* block)
+{
+	block->next = head;
+	head = block;
+	++count;
+}
+
+ChessCellArrayPool::FreeBlock* ChessCellArrayPool::FreeList::pop()
+{
+	FreeBlock* block = head;
+	if(block)
+	{
+		head = block->next;
+		--count;
+	}
+	return block;
+}
+
+void ChessCellArrayPool::FreeList::moveTo(FreeList &that, size_t count)
+{
+	for(; count>0 && head; --count)
+	{
+		that.push(pop());
+	}
+}
+
+ChessCellArrayPool::ThreadCache::ThreadCache()
+	: hits(0), misses(0), inUseChange(0)
+{
+	for(auto &list : lists)
+	{
+		list.head = nullptr;
+		list.count = 0;
+	}
+}
+
+ChessCellArrayPool::ThreadCache::~ThreadCache()
+{
+	std::lock_guard<std::mutex> lock(globalMutex);
+	for(size_t i=0; i<SIZE_CLASS_COUNT; ++i)
+	{
+		lists[i].moveTo(globalLists[i], lists[i].count);
+	}
+	flushStatistics(*this);
+}
+
+ChessCellArrayPool::ThreadCache& ChessCellArrayPool::threadCache()
+{
+	thread_local ThreadCache cache;
+	return cache;
+}
+
+size_t ChessCellArrayPool::sizeClass(size_t cellCount)
+{
+	size_t result = 0;
+	while(blockSize(result) < cellCount)
+	{
+		++result;
+	}
+	assert(result < SIZE_CLASS_COUNT);
+	return result;
+}
+
+size_t ChessCellArrayPool::blockSize(size_t sizeClass)
+{
+	return MIN_BLOCK_SIZE << sizeClass;
+}
+
+void ChessCellArrayPool::flushStatistics(ThreadCache &cache)
+{
+	globalStatistics.hits += cache.hits;
+	globalStatistics.misses += cache.misses;
+	globalStatistics.inUse += cache.inUseChange;
+	if(globalStatistics.inUse > globalStatistics.highWater)
+	{
+		globalStatistics.highWater = globalStatistics.inUse;
+	}
+	cache.hits = cache.misses = 0;
+	cache.inUseChange = 0;
+}
+
+ChessPiece* ChessCellArrayPool::allocate(size_t cellCount)
+{
+	ThreadCache &cache = threadCache();
+	const size_t sc = sizeClass(cellCount);
+	FreeList &list = cache.lists[sc];
+	
+	++cache.inUseChange;
+	if(!list.head)
+	{
+		// refill from the global pool
+		std::lock_guard<std::mutex> lock(globalMutex);
+		globalLists[sc].moveTo(list, BATCH_SIZE);
+		flushStatistics(cache);
+	}
+	
+	FreeBlock* block = list.pop();
+	if(block)
+	{
+		++cache.hits;
+		return reinterpret_cast<ChessPiece*>(block);
+	}
+	++cache.misses;
+	return static_cast<ChessPiece*>(::operator new(blockSize(sc)));
+}
+
+void ChessCellArrayPool::deallocate(ChessPiece* cells, size_t cellCount)
+{
+	ThreadCache &cache = threadCache();
+	const size_t sc = sizeClass(cellCount);
+	FreeList &list = cache.lists[sc];
+	
+	--cache.inUseChange;
+	list.push(reinterpret_cast<FreeBlock*>(cells));
+	if(list.count >= 2*BATCH_SIZE)
+	{
+		// keep one batch for ourselves, the other threads may be short of the arrays
+		std::lock_guard<std::mutex> lock(globalMutex);
+		list.moveTo(globalLists[sc], BATCH_SIZE);
+		flushStatistics(cache);
+	}
+}
+
+ChessCellArrayPool::Statistics ChessCellArrayPool::getStatistics()
+{
+	std::lock_guard<std::mutex> lock(globalMutex);
+	flushStatistics(threadCache());
+	return globalStatistics;
+}
@@ -0,0 +1,69 @@
+#ifndef CHESSCELLARRAYPOOL__
+#define CHESSCELLARRAYPOOL__
+
+#include "config.hpp"
+
+#include <mutex>
+#include <cstdint>
+
+#include "ChessPiece.hpp"
+
+// the free lists for the board cell arrays of ChessBoard::makeIFrame/makePFrame:
+// every thread keeps its own lists and exchanges the arrays with the global pool in batches,
+// so the threads hardly ever meet on a lock and never in malloc
+class ChessCellArrayPool
+{
+public:
+	static const size_t MIN_BLOCK_SIZE = 64; // cells, the smallest size class (8x8)
+	static const size_t SIZE_CLASS_COUNT = 11; // 64, 128, ... 64K cells
+	static const size_t BATCH_SIZE = 64; // arrays moved between a thread and the global pool at once
+	
+	struct Statistics
+	{
+		uint64_t hits; // served from a free list
+		uint64_t misses; // had to go to operator new
+		int64_t inUse; // arrays handed out and not returned
+		int64_t highWater; // the most arrays in use, sampled at the batch exchanges
+	};
+	
+	// cellCount must be the same for the allocation and the deallocation
+	static ChessPiece* allocate(size_t cellCount);
+	static void deallocate(ChessPiece* cells, size_t cellCount);
+	
+	static Statistics getStatistics();
+private:
+	struct FreeBlock // lives in the unused array itself
+	{
+		FreeBlock* next;
+	};
+	struct FreeList
+	{
+		FreeBlock* head;
+		size_t count;
+		
+		void push(FreeBlock* block);
+		FreeBlock* pop();
+		void moveTo(FreeList &that, size_t count); // up to count blocks
+	};
+	struct ThreadCache
+	{
+		FreeList lists[SIZE_CLASS_COUNT];
+		uint64_t hits;
+		uint64_t misses;
+		int64_t inUseChange; // since the last flush to the global statistics
+		
+		ThreadCache();
+		~ThreadCache(); // gives everything back to the global pool
+	};
+	
+	static std::mutex globalMutex; // guards globalLists and globalStatistics
+	static FreeList globalLists[SIZE_CLASS_COUNT];
+	static Statistics globalStatistics;
+	
+	static ThreadCache& threadCache();
+	static size_t sizeClass(size_t cellCount);
+	static size_t blockSize(size_t sizeClass);
+	static void flushStatistics(ThreadCache &cache); // globalMutex must be locked
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef CHESSCOMPACTMOVE__
+#define CHESSCOMPACTMOVE__
+
+#include "config.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <utility>
+#include <algorithm>
+
+#include "ChessPiece.hpp"
+#include "ChessPlayerColour.hpp"
+#include "ChessGameParameters.hpp"
+
+// a generated move before its board is made: 32 bits, as the cells go up to 2047 (see ChessBoardChange)
+struct ChessCompactMove
+{
+	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+
+	enum Kind
+	{
+		NORMAL = 0, // a move or a take
+		DOUBLE_PUSH = 1, // a pawn from its first rank, over the en passan cell
+		EN_PASSAN = 2, // to is the en passan cell, the taken pawn is beside from
+		CASTLING = 3 // from and to are the king's, the rook is found in ChessGameParameters::castling
+	};
+
+	uint32_t from : 11;
+	uint32_t to : 11;
+	uint32_t kind : 2;
+	uint32_t promotion : 5; // the piece the pawn turns into, EMPTY_CELL if none
+
+	ChessCompactMove() = default; // uninitialised, for ChessMoveList
+	ChessCompactMove(BoardPosition_t from_, BoardPosition_t to_, Kind kind_=NORMAL, ChessPiece promotion_=EMPTY_CELL)
+	: from(from_), to(to_), kind(kind_), promotion(promotion_)
+	{}
+
+	bool operator==(const ChessCompactMove &that) const
+	{
+		return from==that.from && to==that.to && kind==that.kind && promotion==that.promotion;
+	}
+
+	BoardPosition_t getTaken(const ChessGameParameters &param) const // the cell of the pawn taken en passan
+	{
+		return from - from % param.width + to % param.width;
+	}
+	BoardPosition_t getRookFrom(const ChessGameParameters &param, ChessPlayerColour colour) const
+	{
+		return param.castling[toArrayPosition(colour)][to < from ? 0 : 1];
+	}
+	BoardPosition_t getRookTo() const // next to the king, or the king's cell when the king has moved by one
+	{
+		return (from > to ? from - to : to - from) == 2 ? (from + to) / 2 : from;
+	}
+};
+
+static_assert(sizeof(ChessCompactMove) == 4, "the moves are kept for every analysed board");
+
+// the moves of one position, on the stack while they are generated and ordered;
+// a position with more of them (the big boards full of sliders) goes on in a heap buffer
+class ChessMoveList
+{
+public:
+	// 218 is the most known for 8x8, the fairy pieces of 10x8 stay well below this
+	static const size_t INLINE_SIZE = 512;
+
+	struct Entry
+	{
+		ChessCompactMove move;
+		int64_t score; // for ordering, the greater is not necessarily the better
+	};
+	typedef Entry* iterator;
+	typedef const Entry* const_iterator;
+private:
+	Entry* entries; // local, or the heap buffer once it is full
+	size_t count;
+	size_t capacity;
+	Entry local[INLINE_SIZE];
+
+	void grow()
+	{
+		Entry* bigger = new Entry[capacity*2];
+		std::copy(entries, entries+count, bigger);
+		if(entries!=local)
+		{
+			delete[] entries;
+		}
+		entries = bigger;
+		capacity *= 2;
+	}
+public:
+	ChessMoveList()
+	: entries(local), count(0), capacity(INLINE_SIZE)
+	{}
+	ChessMoveList(const ChessMoveList &that) = delete;
+	ChessMoveList& operator=(const ChessMoveList &that) = delete;
+	~ChessMoveList()
+	{
+		if(entries!=local)
+		{
+			delete[] entries;
+		}
+	}
+
+	void push_back(const ChessCompactMove &move)
+	{
+		if(count==capacity)
+		{
+			grow();
+		}
+		entries[count].move = move;
+		entries[count].score = 0;
+		++count;
+	}
+	void clear() { count = 0; }
+
+	size_t size() const { return count; }
+	bool empty() const { return count==0; }
+
+	Entry& operator[](size_t i) { return entries[i]; }
+	const Entry& operator[](size_t i) const { return entries[i]; }
+
+	iterator begin() { return entries; }
+	iterator end() { return entries+count; }
+	const_iterator begin() const { return entries; }
+	const_iterator end() const { return entries+count; }
+};
+
+#endif
@@ -9,9 +9,26 @@
 
 #include "ChessBoardFactory.hpp" // temporary
 
+// static data members
+
+const size_t ChessEngineWorker::DEFAULT_MEMORY_BUDGET;
+
+// class functions
+
 ChessEngineWorker::ChessEngineWorker()
-	: pleaseStop(false)
-{}
+	: frameCache(DEFAULT_MEMORY_BUDGET), pleaseStop(false)
+{
+	slab.setFrameCache(&frameCache);
+}
+
+void ChessEngineWorker::setPositionSharing(bool share)
+{
+	slab.setPositionTable(share ? &positionTable : nullptr);
+	if(!share)
+	{
+		positionTable.clear();
+	}
+}
 
 ChessEngineWorker::Functions_t::Functions_t
 	(ChessEngineWorker::Functions_t::TestBetterV_t testBetterV_,
@@ -92,7 +109,10 @@ ChessBoardAnalysis* ChessEngineWorker::calculation(ChessBoardAnalysis* analysis,
 	{
 		throw ChessEngineWorkerInterruptedException();
 	}
-	analysis->calculatePossibleMoves(); // must be first, even before depth check
+	ChessFrameCache::Pin pin(analysis->getBoard().get()); // on the search path
+	analysis->startPossibleMoves(); // must be first, even before depth check
+	frameCache.touch(analysis->getBoard().get());
+	frameCache.enforce();
 	if(depth<=0)
 	{
 		if(initial)
@@ -109,11 +129,11 @@ ChessBoardAnalysis* ChessEngineWorker::calculation(ChessBoardAnalysis* analysis,
 	{
 		return analysis;
 	}
-	auto possibleMoves = analysis->getPossibleMoves();
-	if(possibleMoves->empty())
+	if(!analysis->hasPossibleMove(0))
 	{
 		return analysis;
 	}
+	auto possibleMoves = analysis->getPossibleMoves(); // grows as the moves are picked
 	ChessBoardAnalysis* res=nullptr;
 	
 	weight_type v;
@@ -132,16 +152,20 @@ ChessBoardAnalysis* ChessEngineWorker::calculation(ChessBoardAnalysis* analysis,
 		functionsNum = 1;
 	}
 	
-	for(size_t i=0, end=possibleMoves->size(); i<end; ++i)
+	for(size_t i=0; analysis->hasPossibleMove(i); ++i)
 	{
+		// the move is tested and its board is made only now, when it is searched
+		ChessBoard::ptr move = analysis->getPossibleMove(i);
+		
 		// take up memory
-		possibleMoves->at(i)->makeIFrame();
+		move->makeIFrame();
 		
 		// make new analysis
-		ChessBoardAnalysis* analysis = ChessBoard::getAnalysis(possibleMoves->at(i));
+		ChessBoardAnalysis* moveAnalysis = ChessBoard::getAnalysis(move);
 
 		// we are changing res only if v also changes
-		auto potentialRes = calculation(std::move(analysis), depth-1, alpha, beta, maximizingPlayer, initial);
+		auto potentialRes = calculation(moveAnalysis, depth-1, alpha, beta, maximizingPlayer, initial);
+		potentialRes->getBoard()->makeIFrame(); // in case the budget has demoted it
 		auto potentialV = potentialRes->chessPositionWeight()*getWeightMultiplier(maximizingPlayer);
 		
 		//Log::info(std::string("test ")+std::to_string(potentialV)+std::string(" ")+std::to_string(v)+std::string(" ")+std::to_string(testBetterV(potentialV, v)));
@@ -154,15 +178,20 @@ ChessBoardAnalysis* ChessEngineWorker::calculation(ChessBoardAnalysis* analysis,
 			if(i) // if(i>0)
 			{
 				// releasiqng memory of old best
-				possibleMoves->at(0)->makePFrame();
+				possibleMoves->at(0).board->makePFrame();
 				
-				std::swap<ChessBoard::ptr>(possibleMoves->operator[](0), possibleMoves->operator[](i));
+				std::swap(possibleMoves->operator[](0), possibleMoves->operator[](i));
+			}
+			if(!possibleMoves->at(0).board->isKeyframe() && possibleMoves->at(0).board != res->getBoard())
+			{
+				// rebuilt from the nearest keyframe when it is searched again
+				possibleMoves->at(0).board->makePFrame();
 			}
 		}
 		else
 		{
 			// release memory
-			possibleMoves->at(i)->makePFrame();
+			move->makePFrame();
 		}
 		alpha = functions[functionsNum].newAlpha(alpha, v);
 		beta = functions[functionsNum].newBeta(beta, v);
@@ -186,6 +215,8 @@ void ChessEngineWorker::startNextMoveCalculationInternal(ChessBoard::ptr origina
 {
 	assert(original!=nullptr);
 	
+	ChessBoardSlab::Scope scope(slab); // the boards made by this thread belong to the search
+	
 	try
 	{
 		int depth = startDepth;
@@ -199,11 +230,15 @@ void ChessEngineWorker::startNextMoveCalculationInternal(ChessBoard::ptr origina
 					ChessBoardAnalysis::MIN_WEIGHT, ChessBoardAnalysis::MAX_WEIGHT,
 					original->getTurn());
 
+				best->getBoard()->makeIFrame(); // in case the budget has demoted it
 				Log::info(std::string("found best move. depth=")+std::to_string(depth));
 				Log::info(ChessMove::generateCompleteMoveChain(best->getBoard()));
 				Log::info(std::to_string(best->chessPositionWeight()/(double)(PIECE_WEIGHT_MULTIPLIER*PIECE_PRESENT_MILTIPLIER)));
 
-				positionPreferences.emplace_front(best->chessPositionWeight(), best->getBoard());
+				// the first move of the line is where the search has put it, at the front of the moves of the original
+				// (the line can't be walked back from its end, a shared board keeps only one of its parents)
+				ChessBoard::ptr firstMove = best->getBoard()==original ? original : originalAnalysis->getPossibleMoves()->front().board;
+				positionPreferences.emplace_front(best->chessPositionWeight(), firstMove);
 				++depth;
 			}
 			catch(std::bad_alloc& e)
@@ -226,6 +261,48 @@ void ChessEngineWorker::startNextMoveCalculationInternal(ChessBoard::ptr origina
 	}
 }
 
+ChessEngine::~ChessEngine()
+{
+	worker.slab.setFrameCache(nullptr);
+	worker.setPositionSharing(false);
+	worker.slab.freeze();
+	
+	// the first position outside of the slab (the one from setCurPos) must not point into it anymore
+	for(auto pos = curPos; pos; pos = pos->getFrom())
+	{
+		if(!worker.slab.owns(pos.get()))
+		{
+			pos->clearPossibleMoves();
+			break;
+		}
+	}
+	
+	curPos.reset();
+	worker.original.reset();
+	worker.positionPreferences.clear();
+	worker.slab.release();
+}
+
+void ChessEngine::setMemoryBudget(size_t bytes)
+{
+	worker.frameCache.setBudget(bytes);
+}
+
+ChessFrameCache::Statistics ChessEngine::getMemoryStatistics() const
+{
+	return worker.frameCache.getStatistics();
+}
+
+void ChessEngine::setPositionSharing(bool share)
+{
+	worker.setPositionSharing(share);
+}
+
+ChessPositionTable::Statistics ChessEngine::getPositionStatistics() const
+{
+	return worker.positionTable.getStatistics();
+}
+
 void ChessEngine::setCurPos(ChessBoard::ptr newPos)
 {
 	curPos = newPos;
@@ -275,18 +352,7 @@ ChessBoard::ptr ChessEngine::getNextBestMove()
 		Log::info("No new result has been found");
 		return nullptr;
 	}
-	auto next = result;
-	for(;;)
-	{
-		auto previous = next->getFrom();
-		assert(previous!=nullptr);
-		if(previous==curPos)
-		{
-			break;
-		}
-		next = previous;
-	}
-	return next;
+	return result;
 }
 
 void ChessEngine::stop()
@@ -5,6 +5,8 @@
 
 #include "ChessBoard.hpp"
 #include "ChessBoardAnalysis.hpp"
+#include "ChessFrameCache.hpp"
+#include "ChessPositionTable.hpp"
 #include <list>
 #include <functional>
 #include <thread>
@@ -15,6 +17,7 @@ class ChessEngineWorker
 {
 	static const size_t ADDITIONAL_CALCULATION_WIDTH = 2;
 	static const int ADDITIONAL_CALCULATION_DEPTH = 2;
+	static const size_t DEFAULT_MEMORY_BUDGET = 512*1024*1024; // bytes of the rolled out boards and the analyses
 	struct Functions_t
 	{
 		typedef ChessBoardAnalysis::weight_type weight_type;
@@ -34,6 +37,10 @@ class ChessEngineWorker
 	typedef ChessBoardAnalysis::weight_type weight_type;
 	typedef std::pair<weight_type, ChessBoard::ptr> WeightBoardPair;
 	
+	ChessBoardSlab slab; // the nodes of the search tree, first so it goes last
+	ChessFrameCache frameCache; // keeps the search within the memory budget
+	ChessPositionTable positionTable; // the transpositions of the search, while the sharing is on
+	
 	bool pleaseStop; // request to stop received
 	ChessBoard::ptr original;
 	
@@ -42,6 +49,8 @@ class ChessEngineWorker
 	std::list<WeightBoardPair> positionPreferences;
 	
 	ChessEngineWorker();
+	
+	void setPositionSharing(bool share);
 
 	void stop();
 	void startNextMoveCalculation(ChessBoard::ptr original, int startDepth); // this is what starts the thread
@@ -60,10 +69,19 @@ class ChessEngine
 	
 	int START_DEPTH = 4;
 public:
+	~ChessEngine(); // releases the whole search tree at once
+
 	void setCurPos(ChessBoard::ptr newPos);
 	void makeMove(ChessBoard::ptr move);
 	ChessBoard::ptr getCurPos() const;
 	
+	void setMemoryBudget(size_t bytes); // ChessFrameCache::UNLIMITED to search until std::bad_alloc
+	ChessFrameCache::Statistics getMemoryStatistics() const;
+	
+	// make a transposition once and search it from all its parents (off by default), while the engine is stopped
+	void setPositionSharing(bool share);
+	ChessPositionTable::Statistics getPositionStatistics() const;
+	
 	// TODO: implement calculation of the next move
 	void startNextMoveCalculation();
 	ChessBoard::ptr getNextBestMove();
@@ -0,0 +1,217 @@
+#include "ChessFrameCache.hpp"
+#include "ChessBoard.hpp"
+#include "ChessBoardAnalysis.hpp"
+#include "ChessPositionTable.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+// helper
+
+static ChessBoard* boardAt(ChessBoardSlab::Index_t index)
+{
+	return static_cast<ChessBoard*>(ChessBoardSlab::fromIndex(index));
+}
+
+static bool isHeldBy(const std::vector<ChessBoardAnalysis::PossibleMove>* moves, const ChessBoard* cb)
+{
+	return moves && std::any_of(moves->begin(), moves->end(),
+		[cb](const ChessBoardAnalysis::PossibleMove &move) { return move.board.get()==cb; });
+}
+
+// static data members
+
+const size_t ChessFrameCache::UNLIMITED;
+
+// class functions
+
+ChessFrameCache::Pin::Pin(ChessBoard* board_)
+	: board(board_)
+{
+	++board->makeExtra()->pins;
+}
+
+ChessFrameCache::Pin::~Pin()
+{
+	ChessBoardExtra* e = board->getExtra();
+	assert(e!=nullptr && e->pins>0);
+	--e->pins;
+}
+
+ChessFrameCache::ChessFrameCache(size_t budget_)
+	: budget(budget_), statistics{0, 0, 0, 0},
+	  head(ChessBoardSlab::NULL_INDEX), tail(ChessBoardSlab::NULL_INDEX), count(0)
+{}
+
+void ChessFrameCache::setBudget(size_t bytes)
+{
+	budget = bytes;
+}
+
+size_t ChessFrameCache::getBudget() const
+{
+	return budget;
+}
+
+ChessFrameCache::Statistics ChessFrameCache::getStatistics() const
+{
+	return statistics;
+}
+
+void ChessFrameCache::link(ChessBoard* cb)
+{
+	ChessBoardExtra* e = cb->getExtra();
+	const ChessBoardSlab::Index_t index = ChessBoardSlab::toIndex(cb);
+	e->lruPrev = ChessBoardSlab::NULL_INDEX;
+	e->lruNext = head;
+	if(head!=ChessBoardSlab::NULL_INDEX)
+	{
+		boardAt(head)->getExtra()->lruPrev = index;
+	}
+	else
+	{
+		tail = index;
+	}
+	head = index;
+	++count;
+}
+
+void ChessFrameCache::unlink(ChessBoard* cb)
+{
+	ChessBoardExtra* e = cb->getExtra();
+	if(e->lruPrev!=ChessBoardSlab::NULL_INDEX)
+	{
+		boardAt(e->lruPrev)->getExtra()->lruNext = e->lruNext;
+	}
+	else
+	{
+		head = e->lruNext;
+	}
+	if(e->lruNext!=ChessBoardSlab::NULL_INDEX)
+	{
+		boardAt(e->lruNext)->getExtra()->lruPrev = e->lruPrev;
+	}
+	else
+	{
+		tail = e->lruPrev;
+	}
+	e->lruPrev = e->lruNext = ChessBoardSlab::NULL_INDEX;
+	--count;
+}
+
+void ChessFrameCache::touch(ChessBoard* cb)
+{
+	ChessBoardExtra* e = cb->getExtra();
+	if(!e)
+	{
+		return;
+	}
+	if(e->footprint) // linked
+	{
+		statistics.used -= e->footprint;
+		unlink(cb);
+	}
+	e->footprint = (uint32_t)cb->getFootprint();
+	statistics.used += e->footprint;
+	statistics.highWater = std::max(statistics.highWater, statistics.used);
+	link(cb);
+}
+
+void ChessFrameCache::recount(ChessBoard* cb)
+{
+	ChessBoardExtra* e = cb->getExtra();
+	if(!e || !e->footprint)
+	{
+		return;
+	}
+	statistics.used -= e->footprint;
+	e->footprint = (uint32_t)cb->getFootprint();
+	statistics.used += e->footprint;
+	statistics.highWater = std::max(statistics.highWater, statistics.used);
+}
+
+void ChessFrameCache::remove(ChessBoard* cb)
+{
+	ChessBoardExtra* e = cb->getExtra();
+	if(!e || !e->footprint)
+	{
+		return;
+	}
+	statistics.used -= e->footprint;
+	e->footprint = 0;
+	unlink(cb);
+}
+
+bool ChessFrameCache::isProtected(const ChessBoard* cb)
+{
+	// pinned itself, or the first move all the way up to a pinned board.
+	// a shared board may be the first move of a parent other than the one it was made from,
+	// which isn't seen from here, so the boards under the shared ones are kept to be safe.
+	// the parent it was made from may have let it go as well, then it is held by the others only
+	bool shared = false;
+	for(const ChessBoard* b = cb; ; )
+	{
+		const ChessBoardExtra* e = b->getExtra();
+		if(e && e->pins)
+		{
+			return true;
+		}
+		const ChessPositionTable* table = ChessPositionTable::of(b);
+		const size_t parents = table ? table->getParents(b) : 0;
+		shared = shared || parents > 1;
+		const ChessBoard* parent = b->getFromBoard();
+		if(!parent)
+		{
+			return true; // no search is running over it
+		}
+		const ChessBoardExtra* pe = parent->getExtra();
+		auto moves = (pe && pe->analysis) ? pe->analysis->getPossibleMoves() : nullptr;
+		if(!moves || moves->empty() || moves->front().board.get()!=b)
+		{
+			return shared || (parents && !isHeldBy(moves, b));
+		}
+		b = parent;
+	}
+}
+
+void ChessFrameCache::evict(ChessBoard* cb)
+{
+	ChessBoardExtra* e = cb->getExtra();
+	if(e->analysis)
+	{
+		// the subtree goes with it, the search will find it again if needed
+		ChessBoardAnalysis* analysis = e->analysis;
+		e->analysis = nullptr;
+		delete analysis;
+		++statistics.releasedAnalyses;
+	}
+	if(cb->cells())
+	{
+		++statistics.demotions;
+	}
+	cb->makePFrame(); // unlinks it together with the extra
+	assert(cb->getExtra()==nullptr);
+}
+
+void ChessFrameCache::enforce()
+{
+	if(budget==UNLIMITED)
+	{
+		return;
+	}
+	// the protected ones go to the head, so every board is looked at once at most
+	for(size_t skipped=0; statistics.used > budget && tail!=ChessBoardSlab::NULL_INDEX && skipped<count; )
+	{
+		ChessBoard* cb = boardAt(tail);
+		if(isProtected(cb))
+		{
+			unlink(cb);
+			link(cb);
+			++skipped;
+		}
+		else
+		{
+			evict(cb);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef CHESSFRAMECACHE__
+#define CHESSFRAMECACHE__
+
+#include "config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ChessBoardSlab.hpp"
+
+class ChessBoard;
+
+// the memory budget of a search: the rolled out boards and their analyses of one ChessBoardSlab
+// are kept in the least recently used order, and when they take more than the budget
+// the coldest ones are turned back into the P-frames and their analyses (with the subtrees) are released.
+// the boards on the search path and the best lines hanging from them are never touched
+class ChessFrameCache
+{
+public:
+	static const size_t UNLIMITED = 0;
+
+	struct Statistics
+	{
+		size_t used; // bytes of the cells, the bitboards and the analyses
+		size_t highWater;
+		uint64_t demotions; // I-frames turned into the P-frames
+		uint64_t releasedAnalyses;
+	};
+
+	// the board is being searched, so enforce() must leave it (and the best line under it) alone
+	class Pin
+	{
+		ChessBoard* board;
+	public:
+		Pin(ChessBoard* board_);
+		Pin(const Pin &that) = delete;
+		Pin& operator=(const Pin &that) = delete;
+		~Pin();
+	};
+private:
+	size_t budget;
+	Statistics statistics;
+	ChessBoardSlab::Index_t head, tail; // the boards, the most recently used first
+	size_t count;
+
+	void link(ChessBoard* cb); // at the head
+	void unlink(ChessBoard* cb);
+	static bool isProtected(const ChessBoard* cb);
+	void evict(ChessBoard* cb);
+public:
+	explicit ChessFrameCache(size_t budget_ = UNLIMITED);
+	ChessFrameCache(const ChessFrameCache &that) = delete;
+	ChessFrameCache& operator=(const ChessFrameCache &that) = delete;
+
+	void setBudget(size_t bytes);
+	size_t getBudget() const;
+
+	void touch(ChessBoard* cb); // cb was used: counted again and moved to the head
+	void recount(ChessBoard* cb); // the memory of cb has changed, the place in the list stays
+	void remove(ChessBoard* cb); // cb has nothing rolled out anymore
+
+	void enforce(); // evict the least recently used boards until the budget is met (or only the pinned are left)
+
+	Statistics getStatistics() const;
+};
+
+#endif
@@ -1,4 +1,11 @@
 #include "ChessGameParameters.hpp"
+#include "ChessBitboard.hpp"
+#include "ChessMagic.hpp"
+#include "ChessPaddedMailbox.hpp"
+#include "ChessZobrist.hpp"
+#include "ChessRayTable.hpp"
+#include "ChessAttackMap.hpp"
+#include "ChessBoardAnalysis.hpp"
 
 void ChessGameParameters::setDimentions(
 	ChessGameParameters::BoardPosition_t w, ChessGameParameters::BoardPosition_t h)
@@ -6,4 +13,32 @@ void ChessGameParameters::setDimentions(
 	this->width=w;
 	this->height=h;
 	this->cellCount = h * w;
+	this->castling[0][0] = this->castling[0][1] = this->castling[1][0] = this->castling[1][1] = this->cellCount;
+#ifdef CHESS_FORCE_MAILBOX
+	this->representation = ChessBoardRepresentation::MAILBOX;
+#else
+	this->representation =
+		ChessBitboard::isSupported(*this) ? ChessBoardRepresentation::BITBOARD :
+		ChessWideBitboard::isSupported(*this) ? ChessBoardRepresentation::WIDE_BITBOARD :
+		ChessBoardRepresentation::PADDED_MAILBOX;
+#endif
+	
+	if(this->representation == ChessBoardRepresentation::BITBOARD)
+	{
+		ChessBitboard::init(*this);
+		ChessMagic::init(*this);
+	}
+	else if(this->representation == ChessBoardRepresentation::WIDE_BITBOARD)
+	{
+		ChessWideBitboard::init(*this);
+	}
+	else if(this->representation == ChessBoardRepresentation::PADDED_MAILBOX)
+	{
+		ChessPaddedMailbox::init(*this);
+	}
+	
+	ChessRayTable::init(*this);
+	ChessZobrist::init(*this);
+	ChessAttackMap::init(*this);
+	ChessBoardAnalysis::init(*this);
 }
\ No newline at end of file
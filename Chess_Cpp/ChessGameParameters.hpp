@@ -7,6 +7,14 @@
 
 #include "ChessPiece.hpp"
 
+enum class ChessBoardRepresentation
+{
+	MAILBOX, // cell array only
+	BITBOARD, // cell array and ChessBitboard, up to 64 cells
+	WIDE_BITBOARD, // cell array and ChessWideBitboard, up to 128 cells
+	PADDED_MAILBOX // cell array and ChessPaddedMailbox, the bigger boards
+};
+
 struct ChessGameParameters
 {
 public:
@@ -16,6 +24,8 @@ public:
 	BoardPosition_t width;
 	BoardPosition_t cellCount;
 	std::vector<ChessPiece> possiblePieces;
+	ChessBoardRepresentation representation;
+	BoardPosition_t castling[2][2]; // [colour][side] the rooks that may castle, cellCount if none
 
 	void setDimentions(BoardPosition_t w, BoardPosition_t h);
 };
@@ -0,0 +1,86 @@
+#ifndef CHESSINTRUSIVEPTR__
+#define CHESSINTRUSIVEPTR__
+
+#include "config.hpp"
+
+#include <cstddef>
+#include <utility>
+
+// the counter lives in the object itself, so there is no control block and a copy is a plain increment;
+// T supplies intrusivePtrAddRef(T*) and intrusivePtrRelease(T*), found by the argument-dependent lookup
+template<typename T>
+class ChessIntrusivePtr
+{
+	T* p;
+public:
+	typedef T element_type;
+	
+	ChessIntrusivePtr()
+		: p(nullptr)
+	{}
+	ChessIntrusivePtr(std::nullptr_t)
+		: p(nullptr)
+	{}
+	ChessIntrusivePtr(T* p_) // safe from the raw pointer, the count is in the object
+		: p(p_)
+	{
+		if(p) intrusivePtrAddRef(p);
+	}
+	ChessIntrusivePtr(const ChessIntrusivePtr &that)
+		: p(that.p)
+	{
+		if(p) intrusivePtrAddRef(p);
+	}
+	ChessIntrusivePtr(ChessIntrusivePtr &&that)
+		: p(that.p)
+	{
+		that.p = nullptr;
+	}
+	~ChessIntrusivePtr()
+	{
+		if(p) intrusivePtrRelease(p);
+	}
+	
+	ChessIntrusivePtr& operator=(const ChessIntrusivePtr &that)
+	{
+		ChessIntrusivePtr(that).swap(*this);
+		return *this;
+	}
+	ChessIntrusivePtr& operator=(ChessIntrusivePtr &&that)
+	{
+		ChessIntrusivePtr(std::move(that)).swap(*this);
+		return *this;
+	}
+	ChessIntrusivePtr& operator=(std::nullptr_t)
+	{
+		reset();
+		return *this;
+	}
+	
+	void reset()
+	{
+		ChessIntrusivePtr().swap(*this);
+	}
+	void swap(ChessIntrusivePtr &that)
+	{
+		std::swap(p, that.p);
+	}
+	
+	T* get() const { return p; }
+	T& operator*() const { return *p; }
+	T* operator->() const { return p; }
+	explicit operator bool() const { return p != nullptr; }
+	
+	bool operator==(const ChessIntrusivePtr &that) const { return p == that.p; }
+	bool operator!=(const ChessIntrusivePtr &that) const { return p != that.p; }
+	bool operator==(std::nullptr_t) const { return p == nullptr; }
+	bool operator!=(std::nullptr_t) const { return p != nullptr; }
+};
+
+template<typename T>
+void swap(ChessIntrusivePtr<T> &l, ChessIntrusivePtr<T> &r)
+{
+	l.swap(r);
+}
+
+#endif
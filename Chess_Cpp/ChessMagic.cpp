@@ -0,0 +1,202 @@
+#include "ChessMagic.hpp"
+#include "ChessBitboard.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// static data members
+
+const ChessMagic::BoardPosition_t ChessMagic::MAX_CELL_COUNT;
+const uint64_t ChessMagic::SEED;
+const unsigned ChessMagic::MAX_MAGIC_ATTEMPTS;
+
+bool ChessMagic::usePext = false;
+ChessMagic::Statistics ChessMagic::statistics = { false, 0, 0 };
+ChessMagic::Entry ChessMagic::rookEntries[ChessMagic::MAX_CELL_COUNT];
+ChessMagic::Entry ChessMagic::bishopEntries[ChessMagic::MAX_CELL_COUNT];
+std::vector<ChessMagic::Set_t> ChessMagic::table;
+
+// class functions
+
+bool ChessMagic::isPextSupported()
+{
+#if defined(CHESSMAGIC_INLINE_PEXT) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0] < 7)
+	{
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 8)) != 0; // EBX bit 8
+#elif defined(CHESSMAGIC_INLINE_PEXT)
+	return __builtin_cpu_supports("bmi2");
+#else
+	return false; // a call to PEXT is slower than the magic multiplication
+#endif
+}
+
+ChessMagic::Set_t ChessMagic::walk(const ChessGameParameters &param, BoardPosition_t pos, const MoveTemplate &mt,
+	const Set_t &occupied)
+{
+	const int file = pos % param.width;
+	const int rank = pos / param.width;
+
+	Set_t result = 0;
+	for(auto direction = mt.begin(), directionEnd=mt.end(); direction != directionEnd; ++direction)
+	{
+		for(auto attempt = direction->begin(), attemptEnd=direction->end(); attempt != attemptEnd; ++attempt)
+		{
+			const int newFile = file + attempt->first;
+			const int newRank = rank + attempt->second;
+			if(newFile < 0 || newFile >= param.width || newRank < 0 || newRank >= param.height)
+			{
+				break;
+			}
+			const Set_t to = bitAt<Set_t>(newRank*param.width + newFile);
+			result |= to;
+			if(occupied & to)
+			{
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+ChessMagic::Set_t ChessMagic::blockers(const ChessGameParameters &param, BoardPosition_t pos, const MoveTemplate &mt)
+{
+	Set_t result = 0;
+	for(auto direction = mt.begin(), directionEnd=mt.end(); direction != directionEnd; ++direction)
+	{
+		const MoveTemplate single = { *direction };
+		const Set_t line = walk(param, pos, single, 0);
+		if(line)
+		{
+			// nothing is behind the farthest cell
+			const auto &step = direction->front();
+			const bool goesUp = step.first + step.second * (int)param.width > 0;
+			result |= line & ~bitAt<Set_t>(goesUp ? bitScanReverse(line) : bitScanForward(line));
+		}
+	}
+	return result;
+}
+
+void ChessMagic::fill(const ChessGameParameters &param, Entry* entries, const MoveTemplate &mt,
+	std::vector<size_t> &offsets, std::mt19937_64 &gen)
+{
+	std::vector<Set_t> occupancies, references;
+	std::vector<Set_t> attacks;
+	std::vector<unsigned> epoch; // the attempt that has written the cell of attacks
+
+	offsets.assign(param.cellCount, 0);
+	for(BoardPosition_t pos=0; pos<param.cellCount; ++pos)
+	{
+		Entry &e = entries[pos];
+		int bits = bitCount(e.mask);
+		e.magic = 0;
+		e.shift = bits ? 64 - bits : 63; // an empty mask gives index 0 anyway
+
+		// all the subsets of the mask
+		occupancies.clear();
+		references.clear();
+		Set_t subset = 0;
+		do
+		{
+			occupancies.push_back(subset);
+			references.push_back(walk(param, pos, mt, subset));
+			subset = (subset - e.mask) & e.mask;
+		} while(subset);
+
+		attacks.assign(size_t(1) << bits, 0);
+		if(usePext || !e.mask)
+		{
+			for(size_t i=0, end=occupancies.size(); i<end; ++i)
+			{
+				attacks[index(e, occupancies[i])] = references[i];
+			}
+		}
+		else
+		{
+			// the random sparse numbers until one maps the subsets with the same attacks only together,
+			// with a bit more of index (and twice the table) when none is found soon
+			epoch.assign(attacks.size(), 0);
+			for(unsigned attempt=1; ; )
+			{
+				e.magic = gen() & gen() & gen();
+				if(bitCount((e.mask * e.magic) >> 56) < 6)
+				{
+					continue; // not spreading the mask to the top, unlikely a magic
+				}
+				if(++attempt % MAX_MAGIC_ATTEMPTS == 0)
+				{
+					++bits;
+					e.shift = 64 - bits;
+					attacks.assign(size_t(1) << bits, 0);
+					epoch.assign(attacks.size(), 0);
+				}
+				size_t i = 0;
+				const size_t end = occupancies.size();
+				for(; i<end; ++i)
+				{
+					const size_t idx = index(e, occupancies[i]);
+					if(epoch[idx] != attempt)
+					{
+						epoch[idx] = attempt;
+						attacks[idx] = references[i];
+					}
+					else if(attacks[idx] != references[i])
+					{
+						break;
+					}
+				}
+				if(i==end)
+				{
+					break;
+				}
+			}
+		}
+		offsets[pos] = table.size();
+		table.insert(table.end(), attacks.begin(), attacks.end());
+	}
+}
+
+void ChessMagic::init(const ChessGameParameters &param, bool allowPext)
+{
+	assert(param.cellCount <= MAX_CELL_COUNT);
+	const auto start = std::chrono::steady_clock::now();
+
+	usePext = allowPext && isPextSupported();
+
+	for(BoardPosition_t pos=0; pos<param.cellCount; ++pos)
+	{
+		rookEntries[pos].mask = blockers(param, pos, rookMove);
+		bishopEntries[pos].mask = blockers(param, pos, bishopMove);
+	}
+
+	std::mt19937_64 gen(SEED);
+	std::vector<size_t> rookOffsets, bishopOffsets;
+	table.clear();
+	fill(param, rookEntries, rookMove, rookOffsets, gen);
+	fill(param, bishopEntries, bishopMove, bishopOffsets, gen);
+	table.shrink_to_fit();
+	for(BoardPosition_t pos=0; pos<param.cellCount; ++pos)
+	{
+		rookEntries[pos].attacks = table.data() + rookOffsets[pos];
+		bishopEntries[pos].attacks = table.data() + bishopOffsets[pos];
+	}
+
+	statistics.pext = usePext;
+	statistics.initSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	statistics.footprint = table.capacity()*sizeof(Set_t) + sizeof(rookEntries) + sizeof(bishopEntries);
+}
+
+ChessMagic::Statistics ChessMagic::getStatistics()
+{
+	return statistics;
+}
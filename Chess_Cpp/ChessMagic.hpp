@@ -0,0 +1,99 @@
+#ifndef CHESSMAGIC__
+#define CHESSMAGIC__
+
+#include "config.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <random>
+
+#include "ChessGameParameters.hpp"
+#include "moveTemplate.hpp"
+
+// PEXT where the compiler can emit it inline (a call to it is slower than the magics)
+#if (defined(_MSC_VER) && defined(_M_X64)) || (defined(__BMI2__) && defined(__x86_64__))
+#define CHESSMAGIC_INLINE_PEXT
+#include <immintrin.h>
+#endif
+
+// the rook and bishop attacks (so the queen's and the fairy sliders' made of them) of the boards up to 64 cells,
+// looked up by the occupied cells of their lines: the occupancy is packed into the index of the table of the cell
+// by PEXT when the processor has BMI2, or by a magic multiplication otherwise. the magics are searched by init
+// for the board geometry, the well known ones are for 8x8 only
+class ChessMagic
+{
+public:
+	typedef uint64_t Set_t; // ChessBitboardSet
+	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+
+	static const BoardPosition_t MAX_CELL_COUNT = 64;
+	static const uint64_t SEED = 0xD1B54A32D192ED03ull; // fixed, so the same magics are found from run to run
+
+	struct Statistics
+	{
+		bool pext; // the indexing in use
+		double initSeconds; // of the last init, with the magic search
+		size_t footprint; // bytes of the tables
+	};
+
+	static bool isPextSupported(); // by this processor and this build
+	static void init(const ChessGameParameters &param, bool allowPext = true); // build the tables for the board geometry
+	static Statistics getStatistics();
+
+	static Set_t rookAttacks(BoardPosition_t pos, const Set_t &occupied); // up to and including the blockers
+	static Set_t bishopAttacks(BoardPosition_t pos, const Set_t &occupied);
+private:
+	struct Entry
+	{
+		Set_t mask; // the cells of the lines that can block, the last cell of each line can't
+		uint64_t magic;
+		unsigned shift; // 64 - the bits of the index
+		const Set_t* attacks; // [index] in table
+	};
+
+	static const unsigned MAX_MAGIC_ATTEMPTS = 1 << 12; // for an index width, then the index gets one more bit
+
+	static bool usePext;
+	static Statistics statistics;
+	static Entry rookEntries[MAX_CELL_COUNT];
+	static Entry bishopEntries[MAX_CELL_COUNT];
+	static std::vector<Set_t> table; // of all the cells of both pieces
+
+	static uint64_t pext(uint64_t value, uint64_t mask);
+	static size_t index(const Entry &e, const Set_t &occupied);
+
+	static Set_t walk(const ChessGameParameters &param, BoardPosition_t pos, const MoveTemplate &mt, const Set_t &occupied);
+	static Set_t blockers(const ChessGameParameters &param, BoardPosition_t pos, const MoveTemplate &mt);
+	static void fill(const ChessGameParameters &param, Entry* entries, const MoveTemplate &mt,
+		std::vector<size_t> &offsets, std::mt19937_64 &gen); // appends the tables of the cells to table
+};
+
+#ifdef CHESSMAGIC_INLINE_PEXT
+inline uint64_t ChessMagic::pext(uint64_t value, uint64_t mask)
+{
+	return _pext_u64(value, mask);
+}
+#else
+inline uint64_t ChessMagic::pext(uint64_t, uint64_t)
+{
+	return 0; // not used, isPextSupported() is false
+}
+#endif
+inline size_t ChessMagic::index(const Entry &e, const Set_t &occupied)
+{
+	// the branch goes the same way every time
+	return usePext ? (size_t)pext(occupied, e.mask) : (size_t)(((occupied & e.mask) * e.magic) >> e.shift);
+}
+inline ChessMagic::Set_t ChessMagic::rookAttacks(BoardPosition_t pos, const Set_t &occupied)
+{
+	const Entry &e = rookEntries[pos];
+	return e.attacks[index(e, occupied)];
+}
+inline ChessMagic::Set_t ChessMagic::bishopAttacks(BoardPosition_t pos, const Set_t &occupied)
+{
+	const Entry &e = bishopEntries[pos];
+	return e.attacks[index(e, occupied)];
+}
+
+#endif
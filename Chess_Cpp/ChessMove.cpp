@@ -4,6 +4,52 @@
 #include <cassert>
 #include "Log.hpp"
 
+// helper
+
+// along the rays of the table from the king's cell, the first piece met on every ray is the one that could reach it
+static bool isAttackedAlong(const ChessBoard &position, ChessBoard::BoardPosition_t king, const ChessRayTable &rays,
+	ChessPiece p1, ChessPiece p2, ChessPiece p3, ChessPiece p4)
+{
+	for(auto ray = rays.firstRay(king), rayEnd = rays.endRay(king); ray != rayEnd; ++ray)
+	{
+		for(auto it = rays.begin(ray), end = rays.end(ray); it != end; ++it)
+		{
+			const ChessPiece piece = position.getPiecePos(*it);
+			if(piece==p1 || piece==p2 || piece==p3 || piece==p4)
+			{
+				return true;
+			}
+			if(piece!=EMPTY_CELL)
+			{
+				break;
+			}
+		}
+	}
+	return false;
+}
+
+// the king is looked for from its own cell, every piece that could reach it
+static bool isKingSafeMailbox(const ChessBoard &position, ChessBoard::BoardPosition_t king, ChessPlayerColour by)
+{
+	const bool whiteTurn = (by==ChessPlayerColour::BLACK);
+	
+	// the moves are symmetric, except the pawns': a black pawn takes the king from where a white one would take
+	return !(whiteTurn ?
+		isAttackedAlong(position, king, ChessRayTable::takeRays(BISHOP_WHITE), BISHOP_BLACK, QUEEN_BLACK, PRINCESS_BLACK, AMAZON_BLACK) ||
+		isAttackedAlong(position, king, ChessRayTable::takeRays(ROOK_WHITE), ROOK_BLACK, QUEEN_BLACK, EMPRESS_BLACK, AMAZON_BLACK) ||
+		isAttackedAlong(position, king, ChessRayTable::takeRays(KNIGHT_WHITE), KNIGHT_BLACK, PRINCESS_BLACK, EMPRESS_BLACK, AMAZON_BLACK) ||
+		isAttackedAlong(position, king, ChessRayTable::takeRays(PAWN_WHITE), PAWN_BLACK, PAWN_BLACK, PAWN_BLACK, PAWN_BLACK) ||
+		isAttackedAlong(position, king, ChessRayTable::takeRays(KING_WHITE), KING_BLACK, KING_BLACK, KING_BLACK, KING_BLACK)
+		:
+		isAttackedAlong(position, king, ChessRayTable::takeRays(BISHOP_WHITE), BISHOP_WHITE, QUEEN_WHITE, PRINCESS_WHITE, AMAZON_WHITE) ||
+		isAttackedAlong(position, king, ChessRayTable::takeRays(ROOK_WHITE), ROOK_WHITE, QUEEN_WHITE, EMPRESS_WHITE, AMAZON_WHITE) ||
+		isAttackedAlong(position, king, ChessRayTable::takeRays(KNIGHT_WHITE), KNIGHT_WHITE, PRINCESS_WHITE, EMPRESS_WHITE, AMAZON_WHITE) ||
+		isAttackedAlong(position, king, ChessRayTable::takeRays(PAWN_BLACK), PAWN_WHITE, PAWN_WHITE, PAWN_WHITE, PAWN_WHITE) ||
+		isAttackedAlong(position, king, ChessRayTable::takeRays(KING_WHITE), KING_WHITE, KING_WHITE, KING_WHITE, KING_WHITE));
+}
+
+// class functions
+
 bool ChessMove::isMovePossible(ChessBoard::ptr to)
 {
 	assert(to!=nullptr);
@@ -11,159 +57,83 @@ bool ChessMove::isMovePossible(ChessBoard::ptr to)
 	to->makeIFrame(); // rolling out the memory
 	// note it is not necessary here to free that memory
 	// we have two situations: board is deleted or board is tested
+	return isKingSafe(*to);
+}
 
-	ChessBoard::BoardPosition_t *king = nullptr;
-	const auto & width = ChessBoard::param.width;
-	const auto & height = ChessBoard::param.height;
-	const bool whiteTurn = (to->turn==ChessPlayerColour::BLACK);
-	if(whiteTurn)
+bool ChessMove::isKingSafe(const ChessBoard &position)
+{
+	const ChessPlayerColour turn = position.getTurn();
+	return isKingSafe(position, position.getKingPos(!turn), turn);
+}
+
+bool ChessMove::isKingSafe(const ChessBoard &position, ChessBoard::BoardPosition_t king, ChessPlayerColour by)
+{
+	const ChessBoardExtra* extra = position.getExtra();
+	if(extra->bitboard)
 	{
-		king = to->whiteKingPos;
+		return !extra->bitboard->isAttacked(king, by);
 	}
-	else
+	if(extra->wideBitboard)
 	{
-		king = to->blackKingPos;
+		return !extra->wideBitboard->isAttacked(king, by);
 	}
-
-	for(auto dir=bishopMove.begin(), dirEnd=bishopMove.end(); dir!=dirEnd; ++dir)
+	if(extra->paddedMailbox)
 	{
-		for(auto pos=dir->begin(), posEnd=dir->end(); pos!=posEnd; ++pos)
-		{
-			ChessBoard::BoardPosition_t file = (int)king[1] - (int)pos->first;
-			ChessBoard::BoardPosition_t rank = (int)king[2] - (int)pos->second;
-			if(rank >= height || file >= width )
-			{
-				break;
-			}
-			auto piece = to->getPiecePos(file, rank);
-			if(
-				(  whiteTurn && (piece==BISHOP_BLACK || piece==QUEEN_BLACK) )
-				||
-				( !whiteTurn && (piece==BISHOP_WHITE || piece==QUEEN_WHITE) )
-			)
-			{
-				return false;
-			}
-
-			if(piece!=EMPTY_CELL)
-			{
-				break;
-			}
-		}
+		return !extra->paddedMailbox->isAttacked(king, by);
 	}
 
-	for(auto dir=rookMove.begin(), dirEnd=rookMove.end(); dir!=dirEnd; ++dir)
-	{
-		for(auto pos=dir->begin(), posEnd=dir->end(); pos!=posEnd; ++pos)
-		{
-			ChessBoard::BoardPosition_t file = (int)king[1] - (int)pos->first;
-			ChessBoard::BoardPosition_t rank = (int)king[2] - (int)pos->second;
-			if(rank >= height || file >= width )
-			{
-				break;
-			}
-			auto piece = to->getPiecePos(file, rank);
-			if(
-				(  whiteTurn && (piece==ROOK_BLACK || piece==QUEEN_BLACK) )
-				||
-				( !whiteTurn && (piece==ROOK_WHITE || piece==QUEEN_WHITE) )
-			)
-			{
-				return false;
-			}
+	return isKingSafeMailbox(position, king, by);
+}
 
-			if(piece!=EMPTY_CELL)
-			{
-				break;
-			}
-		}
-	}
+bool ChessMove::isMovePossible(ChessBoard &from, const ChessCompactMove &move)
+{
+	assert(from.cells()!=nullptr);
+	
+	const ChessPlayerColour turn = from.getTurn();
+	ChessBoard::BoardPosition_t king = from.getKingPos(turn);
+	
+	// the changed cells are put back in the reverse order
+	ChessBoardChange undo[4];
+	size_t undoCount = 0;
+	auto change = [&](ChessBoard::BoardPosition_t pos, ChessPiece piece) {
+		undo[undoCount++] = ChessBoardChange(pos, from.getPiecePos(pos));
+		from.setCell(pos, piece);
+	};
 	
-	for(auto dir=knightMove.begin(), dirEnd=knightMove.end(); dir!=dirEnd; ++dir)
+	const ChessPiece piece = from.getPiecePos(move.from);
+	if(move.kind==ChessCompactMove::CASTLING)
 	{
-		for(auto pos=dir->begin(), posEnd=dir->end(); pos!=posEnd; ++pos)
-		{
-			ChessBoard::BoardPosition_t file = (int)king[1] - (int)pos->first;
-			ChessBoard::BoardPosition_t rank = (int)king[2] - (int)pos->second;
-			if(rank >= height || file >= width )
-			{
-				break;
-			}
-			auto piece = to->getPiecePos(file, rank);
-			if(
-				(  whiteTurn && (piece==KNIGHT_BLACK) )
-				||
-				( !whiteTurn && (piece==KNIGHT_WHITE) )
-			)
-			{
-				return false;
-			}
-
-			if(piece!=EMPTY_CELL)
-			{
-				break;
-			}
-		}
+		const auto rookFrom = move.getRookFrom(ChessBoard::param, turn);
+		const ChessPiece rook = from.getPiecePos(rookFrom);
+		change(move.from, EMPTY_CELL);
+		change(rookFrom, EMPTY_CELL);
+		change(move.to, piece);
+		change(move.getRookTo(), rook);
+		king = move.to;
 	}
-	
-	auto dirStart = whiteTurn ? pawnBlackMoveTake.begin() : pawnWhiteMoveTake.begin();
-	auto dirEnd = whiteTurn ? pawnBlackMoveTake.end() : pawnWhiteMoveTake.end();
-	for(auto dir=dirStart; dir!=dirEnd; ++dir)
+	else
 	{
-		for(auto pos=dir->begin(), posEnd=dir->end(); pos!=posEnd; ++pos)
+		change(move.from, EMPTY_CELL);
+		change(move.to, move.promotion!=EMPTY_CELL ? (ChessPiece)move.promotion : piece);
+		if(move.kind==ChessCompactMove::EN_PASSAN)
 		{
-			ChessBoard::BoardPosition_t file = (int)king[1] - (int)pos->first;
-			ChessBoard::BoardPosition_t rank = (int)king[2] - (int)pos->second;
-			if(rank >= height || file >= width )
-			{
-				break;
-			}
-			auto piece = to->getPiecePos(file, rank);
-			if(
-				(  whiteTurn && (piece==PAWN_BLACK) )
-				||
-				( !whiteTurn && (piece==PAWN_WHITE) )
-			)
-			{
-				return false;
-			}
-
-			if(piece!=EMPTY_CELL)
-			{
-				break;
-			}
+			change(move.getTaken(ChessBoard::param), EMPTY_CELL); // it may be the one giving the check
 		}
-	}
-
-	for(auto dir=kingMove.begin(), dirEnd=kingMove.end(); dir!=dirEnd; ++dir)
-	{
-		for(auto pos=dir->begin(), posEnd=dir->end(); pos!=posEnd; ++pos)
+		if(move.from==king)
 		{
-			ChessBoard::BoardPosition_t file = (int)king[1] - (int)pos->first;
-			ChessBoard::BoardPosition_t rank = (int)king[2] - (int)pos->second;
-			if(rank >= height || file >= width )
-			{
-				break;
-			}
-			auto piece = to->getPiecePos(file, rank);
-			if(
-				( to->turn==ChessPlayerColour::WHITE && (piece==KING_BLACK) )
-				||
-				( to->turn==ChessPlayerColour::BLACK && (piece==KING_WHITE) )
-			)
-			{
-				return false;
-			}
-
-			if(piece!=EMPTY_CELL)
-			{
-				break;
-			}
+			king = move.to;
 		}
 	}
-
-	return true;
+	
+	const bool result = isKingSafe(from, king, !turn);
+	
+	for(size_t i=undoCount; i>0; --i)
+	{
+		from.setCell(undo[i-1].pos, (ChessPiece)undo[i-1].piece);
+	}
+	return result;
 }
+
 std::string ChessMove::getNotation(ChessBoard::ptr from, ChessBoard::ptr to)
 {
 	std::string result ="";
@@ -201,72 +171,6 @@ std::string ChessMove::getNotation(ChessBoard::ptr from, ChessBoard::ptr to)
 	return result;
 }
 
-void ChessMove::moveAttempts(
-	const ChessMoveRecordingFunction &recFunTake,
-	const ChessMoveRecordingFunction &recFunDefend,
-	const ChessBoard &cb, const ChessBoard::BoardPosition_t pos,
-	const MoveTemplate& mt,
-	bool canTake, bool canMoveToEmpty)
-{
-	const ChessBoard::BoardPosition_t & width = ChessBoard::param.width;
-	
-	const ChessBoard::BoardPosition_t rank = pos / width;
-	const ChessBoard::BoardPosition_t file = pos % width;
-	
-	ChessBoard::BoardPosition_t newPos;
-	
-	//Log::info("starting to precess directions");
-	for(auto direction = mt.begin(), directionEnd=mt.end(); direction != directionEnd; ++direction)
-	{
-		//Log::info("starting to process attempts");
-		for(auto attempt = direction->begin(), attemptEnd=direction->end(); attempt != attemptEnd; ++attempt)
-		{
-			const int& fileShift = attempt->first;
-			const int& rankShift = attempt->second;
-			
-			ChessBoard::BoardPosition_t newFile = (int)file + fileShift;
-			ChessBoard::BoardPosition_t newRank = (int)rank + rankShift;
-			
-			if( newFile >= width )
-			{
-				break;
-			}
-			
-			newPos = cb.getPos(newFile, newRank);
-			
-			if( newPos >= ChessBoard::param.cellCount )
-			{
-				break;
-			}
-			
-			if(!cb.isEmptyPos(newPos))
-			{
-				//Log::info("not isEmptyPos(newPos)");
-				if(canTake)
-				{
-					//Log::info("canTake");
-					if(getColour(cb.getPiecePos(newPos)) != getColour(cb.getPiecePos(pos)))
-					{
-						recFunTake(pos, newPos);
-					}
-					recFunDefend(pos, newPos);
-				}
-				break; // stop if a cell isn't empty
-			}
-			else // if empty
-			{
-				//Log::info("isEmptyPos(newPos)");
-				if(canMoveToEmpty)
-				{
-					//Log::info("canMoveToEmpty");
-					recFunTake(pos, newPos);
-				}
-				recFunDefend(pos, newPos);
-			}
-		}
-	}
-}
-
 std::string ChessMove::generateCompleteMoveChain(ChessBoard::ptr finalBoard)
 {
 	if(finalBoard==nullptr)
@@ -274,14 +178,15 @@ std::string ChessMove::generateCompleteMoveChain(ChessBoard::ptr finalBoard)
 		return std::string("");
 	}
 	
-	auto from = finalBoard->from;
+	auto from = finalBoard->getFrom();
 	if(!from)
 	{
 		return std::string("");
 	}
 	
+	from->makeIFrame(); // the boards of the line between the keyframes are not rolled out
 	return
 		generateCompleteMoveChain(from) + 
-		std::to_string(finalBoard->moveNum) + std::string(" ") +
+		std::to_string(finalBoard->getMoveNum()) + std::string(" ") +
 		getNotation(from, finalBoard) + std::string(" | ");
 }
\ No newline at end of file
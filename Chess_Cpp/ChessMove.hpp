@@ -6,25 +6,163 @@
 #include "ChessBoard.hpp"
 #include "ChessPlayerColour.hpp"
 #include "moveTemplate.hpp"
+#include "ChessRayTable.hpp"
+#include "ChessCompactMove.hpp"
 #include <string>
-#include <functional>
 
 
 class ChessMove
 {
+	static bool isKingSafe(const ChessBoard &position); // the king of the side that has just moved isn't attacked
+	static bool isKingSafe(const ChessBoard &position, ChessBoard::BoardPosition_t king, ChessPlayerColour by);
 public:
-	typedef std::function<void(ChessBoard::BoardPosition_t, ChessBoard::BoardPosition_t)> ChessMoveRecordingFunction;
-	
 	static bool isMovePossible(ChessBoard::ptr to);
+	static bool isMovePossible(ChessBoard &from, const ChessCompactMove &move); // made on the I-frame in place and taken back
+	
+	// the cells the piece on pos reaches are passed to the visitors, recordTake(pos, newPos) for the moves and
+	// recordDefend(pos, newPos) for the attacked cells; they are template parameters so the calls get inlined
+	template<typename RecordTake, typename RecordDefend>
 	static void moveAttempts(
-		const ChessMoveRecordingFunction &recFunTake,
-		const ChessMoveRecordingFunction &recFunDefend,
+		const RecordTake &recordTake,
+		const RecordDefend &recordDefend,
 		const ChessBoard &cb, ChessBoard::BoardPosition_t pos,
-		const MoveTemplate& mt,
+		const ChessRayTable &rays,
+		bool canTake=true, bool canMoveToEmpty=true);
+	template<typename RecordTake, typename RecordDefend>
+	static void moveAttempts( // the same, but walking over ChessPaddedMailbox without bounds checks
+		const RecordTake &recordTake,
+		const RecordDefend &recordDefend,
+		const ChessBoard &cb, const ChessPaddedMailbox &pm, ChessBoard::BoardPosition_t pos,
+		const ChessPaddedMailbox::Directions &dirs,
+		bool canTake=true, bool canMoveToEmpty=true);
+	template<typename RecordTake, typename RecordDefend, typename Bitboard>
+	static void moveAttempts( // the same, but the reachable cells come from the bitboard
+		const RecordTake &recordTake,
+		const RecordDefend &recordDefend,
+		const ChessBoard &cb, const Bitboard &bb, ChessBoard::BoardPosition_t pos,
+		typename Bitboard::Set_t reachable,
 		bool canTake=true, bool canMoveToEmpty=true);
 	
 	static std::string getNotation(ChessBoard::ptr from, ChessBoard::ptr to);	
 	static std::string generateCompleteMoveChain(ChessBoard::ptr finalBoard);
 };
 
+template<typename RecordTake, typename RecordDefend>
+inline void ChessMove::moveAttempts(
+	const RecordTake &recordTake,
+	const RecordDefend &recordDefend,
+	const ChessBoard &cb, const ChessBoard::BoardPosition_t pos,
+	const ChessRayTable &rays,
+	bool canTake, bool canMoveToEmpty)
+{
+	const ChessPlayerColour colour = getColour(cb.getPiecePos(pos));
+	
+	for(auto ray = rays.firstRay(pos), rayEnd = rays.endRay(pos); ray != rayEnd; ++ray)
+	{
+		// the cells are on the board already, the ray only stops at a piece
+		for(auto it = rays.begin(ray), end = rays.end(ray); it != end; ++it)
+		{
+			const ChessBoard::BoardPosition_t newPos = *it;
+			const ChessPiece piece = cb.getPiecePos(newPos);
+			if(piece!=EMPTY_CELL)
+			{
+				if(canTake)
+				{
+					if(getColour(piece) != colour)
+					{
+						recordTake(pos, newPos);
+					}
+					recordDefend(pos, newPos);
+				}
+				break; // stop if a cell isn't empty
+			}
+			if(canMoveToEmpty)
+			{
+				recordTake(pos, newPos);
+			}
+			recordDefend(pos, newPos);
+		}
+	}
+}
+
+template<typename RecordTake, typename RecordDefend>
+inline void ChessMove::moveAttempts(
+	const RecordTake &recordTake,
+	const RecordDefend &recordDefend,
+	const ChessBoard &cb, const ChessPaddedMailbox &pm, const ChessBoard::BoardPosition_t pos,
+	const ChessPaddedMailbox::Directions &dirs,
+	bool canTake, bool canMoveToEmpty)
+{
+	const auto start = ChessPaddedMailbox::toPadded(pos);
+	const auto colour = getColour(cb.getPiecePos(pos));
+	
+	for(auto direction = dirs.begin(), directionEnd=dirs.end(); direction != directionEnd; ++direction)
+	{
+		auto cur = start;
+		for(size_t step=0; step < direction->maxSteps; ++step)
+		{
+			cur += direction->step;
+			const ChessPiece piece = pm.getPiece(cur);
+			
+			if(piece==EMPTY_CELL)
+			{
+				const auto newPos = ChessPaddedMailbox::toPlain(cur);
+				if(canMoveToEmpty)
+				{
+					recordTake(pos, newPos);
+				}
+				recordDefend(pos, newPos);
+				continue;
+			}
+			if(piece!=ChessPaddedMailbox::OFF_BOARD && canTake)
+			{
+				const auto newPos = ChessPaddedMailbox::toPlain(cur);
+				if(getColour(piece) != colour)
+				{
+					recordTake(pos, newPos);
+				}
+				recordDefend(pos, newPos);
+			}
+			break; // stop if a cell isn't empty
+		}
+	}
+}
+
+template<typename RecordTake, typename RecordDefend, typename Bitboard>
+inline void ChessMove::moveAttempts(
+	const RecordTake &recordTake,
+	const RecordDefend &recordDefend,
+	const ChessBoard &cb, const Bitboard &bb, const ChessBoard::BoardPosition_t pos,
+	typename Bitboard::Set_t reachable,
+	bool canTake, bool canMoveToEmpty)
+{
+	typedef typename Bitboard::Set_t Set_t;
+	
+	Set_t occupied = reachable & bb.getOccupied();
+	Set_t empty = reachable & ~bb.getOccupied();
+	
+	if(canTake)
+	{
+		const Set_t opponent = bb.getColour(!getColour(cb.getPiecePos(pos)));
+		while(occupied)
+		{
+			const auto newPos = popFirstBit(occupied);
+			if(opponent & bitAt<Set_t>(newPos))
+			{
+				recordTake(pos, newPos);
+			}
+			recordDefend(pos, newPos);
+		}
+	}
+	while(empty)
+	{
+		const auto newPos = popFirstBit(empty);
+		if(canMoveToEmpty)
+		{
+			recordTake(pos, newPos);
+		}
+		recordDefend(pos, newPos);
+	}
+}
+
 #endif
\ No newline at end of file
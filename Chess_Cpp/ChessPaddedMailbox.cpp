@@ -0,0 +1,145 @@
+#include "ChessPaddedMailbox.hpp"
+
+#include <cassert>
+#include <cstdlib>
+
+// static data members
+
+const ChessPiece ChessPaddedMailbox::OFF_BOARD;
+const ChessPaddedMailbox::PaddedPosition_t ChessPaddedMailbox::PADDING_FILES;
+const ChessPaddedMailbox::PaddedPosition_t ChessPaddedMailbox::PADDING_RANKS;
+
+ChessPaddedMailbox::PaddedPosition_t ChessPaddedMailbox::paddedWidth = 0;
+ChessPaddedMailbox::PaddedPosition_t ChessPaddedMailbox::paddedCellCount = 0;
+std::vector<ChessPaddedMailbox::PaddedPosition_t> ChessPaddedMailbox::plainToPadded;
+std::vector<ChessPaddedMailbox::BoardPosition_t> ChessPaddedMailbox::paddedToPlain;
+
+ChessPaddedMailbox::Directions ChessPaddedMailbox::takeMoves[KNOWN_CHESS_PIECE_COUNT];
+ChessPaddedMailbox::Directions ChessPaddedMailbox::noTakeMoves[KNOWN_CHESS_PIECE_COUNT];
+ChessPaddedMailbox::Directions ChessPaddedMailbox::rookDirections;
+ChessPaddedMailbox::Directions ChessPaddedMailbox::bishopDirections;
+ChessPaddedMailbox::Directions ChessPaddedMailbox::knightDirections;
+ChessPaddedMailbox::Directions ChessPaddedMailbox::kingDirections;
+ChessPaddedMailbox::Directions ChessPaddedMailbox::pawnTakeDirections[2];
+
+// class functions
+
+ChessPaddedMailbox::Directions ChessPaddedMailbox::compile(const MoveTemplate &mt)
+{
+	Directions result;
+	result.reserve(mt.size());
+	for(auto direction = mt.begin(), directionEnd=mt.end(); direction != directionEnd; ++direction)
+	{
+		const auto &first = direction->front();
+		// the sentinels are only deep enough for the single steps and the knight jumps
+		assert(std::abs(first.first) <= 2*PADDING_FILES && std::abs(first.second) <= PADDING_RANKS);
+
+		Direction d;
+		d.step = first.first + first.second*paddedWidth;
+		d.maxSteps = direction->size();
+		result.push_back(d);
+	}
+	return result;
+}
+
+void ChessPaddedMailbox::init(const ChessGameParameters &param)
+{
+	paddedWidth = param.width + 2*PADDING_FILES;
+	paddedCellCount = paddedWidth * (param.height + 2*PADDING_RANKS);
+
+	plainToPadded.assign(param.cellCount, 0);
+	paddedToPlain.assign(paddedCellCount, param.cellCount);
+	for(BoardPosition_t pos=0; pos<param.cellCount; ++pos)
+	{
+		const PaddedPosition_t padded =
+			(pos / param.width + PADDING_RANKS)*paddedWidth + pos % param.width + PADDING_FILES;
+		plainToPadded[pos] = padded;
+		paddedToPlain[padded] = pos;
+	}
+
+	for(size_t piece=0; piece<KNOWN_CHESS_PIECE_COUNT; ++piece)
+	{
+		takeMoves[piece].clear();
+		noTakeMoves[piece].clear();
+
+		auto pieceParam = moveParameters[piece];
+		if(!pieceParam) continue; // EMPTY_CELL
+
+		takeMoves[piece] = compile(*pieceParam->takeMove);
+		noTakeMoves[piece] = compile(*pieceParam->noTakeMove);
+	}
+
+	rookDirections = compile(rookMove);
+	bishopDirections = compile(bishopMove);
+	knightDirections = compile(knightMove);
+	kingDirections = compile(kingMove);
+	pawnTakeDirections[toArrayPosition(ChessPlayerColour::WHITE)] = compile(pawnWhiteMoveTake);
+	pawnTakeDirections[toArrayPosition(ChessPlayerColour::BLACK)] = compile(pawnBlackMoveTake);
+}
+
+const ChessPaddedMailbox::Directions& ChessPaddedMailbox::takeDirections(ChessPiece piece)
+{
+	return takeMoves[piece];
+}
+
+const ChessPaddedMailbox::Directions& ChessPaddedMailbox::noTakeDirections(ChessPiece piece)
+{
+	return noTakeMoves[piece];
+}
+
+ChessPaddedMailbox::ChessPaddedMailbox()
+	: cells(paddedCellCount, OFF_BOARD)
+{
+	for(auto padded : plainToPadded)
+	{
+		cells[padded] = EMPTY_CELL;
+	}
+}
+
+void ChessPaddedMailbox::placePiece(BoardPosition_t pos, ChessPiece piece)
+{
+	cells[toPadded(pos)] = piece;
+}
+
+bool ChessPaddedMailbox::isAttackedAlong(PaddedPosition_t pos, const Directions &dirs,
+	ChessPiece p1, ChessPiece p2, ChessPiece p3, ChessPiece p4) const
+{
+	for(auto dir = dirs.begin(), dirEnd = dirs.end(); dir != dirEnd; ++dir)
+	{
+		PaddedPosition_t cur = pos;
+		for(size_t step = 0; step < dir->maxSteps; ++step)
+		{
+			cur += dir->step;
+			const ChessPiece piece = cells[cur];
+			if(piece==p1 || piece==p2 || piece==p3 || piece==p4)
+			{
+				return true;
+			}
+			if(piece!=EMPTY_CELL) // includes OFF_BOARD
+			{
+				break;
+			}
+		}
+	}
+	return false;
+}
+
+bool ChessPaddedMailbox::isAttacked(BoardPosition_t pos, ChessPlayerColour by) const
+{
+	// white pieces are odd, the black ones follow them
+	const ChessPiece c = (ChessPiece)toArrayPosition(by);
+	const PaddedPosition_t padded = toPadded(pos);
+
+	return
+		// a pawn of 'by' attacks pos if a pawn of the other colour standing on pos would attack it
+		isAttackedAlong(padded, pawnTakeDirections[toArrayPosition(!by)],
+			PAWN_WHITE+c, PAWN_WHITE+c, PAWN_WHITE+c, PAWN_WHITE+c) ||
+		isAttackedAlong(padded, knightDirections,
+			KNIGHT_WHITE+c, PRINCESS_WHITE+c, EMPRESS_WHITE+c, AMAZON_WHITE+c) ||
+		isAttackedAlong(padded, kingDirections,
+			KING_WHITE+c, KING_WHITE+c, KING_WHITE+c, KING_WHITE+c) ||
+		isAttackedAlong(padded, rookDirections,
+			ROOK_WHITE+c, QUEEN_WHITE+c, EMPRESS_WHITE+c, AMAZON_WHITE+c) ||
+		isAttackedAlong(padded, bishopDirections,
+			BISHOP_WHITE+c, QUEEN_WHITE+c, PRINCESS_WHITE+c, AMAZON_WHITE+c);
+}
@@ -0,0 +1,80 @@
+#ifndef CHESSPADDEDMAILBOX__
+#define CHESSPADDEDMAILBOX__
+
+#include "config.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#include "ChessPiece.hpp"
+#include "ChessPlayerColour.hpp"
+#include "ChessGameParameters.hpp"
+#include "moveTemplate.hpp"
+
+// the cell array surrounded by the off-board cells (10x12 layout for 8x8):
+// a sentinel file on each side and two sentinel ranks below and above,
+// so a knight jump or a ray step from any cell stays inside the array
+class ChessPaddedMailbox
+{
+public:
+	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+	typedef int32_t PaddedPosition_t;
+
+	static const ChessPiece OFF_BOARD = 0xFF;
+	static const PaddedPosition_t PADDING_FILES = 1; // on each side; two neighbouring ranks give 2 in a row
+	static const PaddedPosition_t PADDING_RANKS = 2; // on each side; the knight jumps 2 ranks
+
+	struct Direction
+	{
+		PaddedPosition_t step; // difference of the padded positions
+		size_t maxSteps; // the length of the ray in the MoveTemplate
+	};
+	typedef std::vector<Direction> Directions;
+
+	static void init(const ChessGameParameters &param); // build the tables for the board geometry
+
+	static PaddedPosition_t toPadded(BoardPosition_t pos);
+	static BoardPosition_t toPlain(PaddedPosition_t padded);
+
+	static const Directions& takeDirections(ChessPiece piece);
+	static const Directions& noTakeDirections(ChessPiece piece);
+private:
+	static PaddedPosition_t paddedWidth;
+	static PaddedPosition_t paddedCellCount;
+	static std::vector<PaddedPosition_t> plainToPadded; // [pos]
+	static std::vector<BoardPosition_t> paddedToPlain; // [padded], cellCount for OFF_BOARD
+
+	static Directions takeMoves[KNOWN_CHESS_PIECE_COUNT];
+	static Directions noTakeMoves[KNOWN_CHESS_PIECE_COUNT];
+	static Directions rookDirections, bishopDirections, knightDirections, kingDirections;
+	static Directions pawnTakeDirections[2]; // [colour]
+
+	static Directions compile(const MoveTemplate &mt);
+
+	std::vector<ChessPiece> cells; // [padded]
+
+	bool isAttackedAlong(PaddedPosition_t pos, const Directions &dirs,
+		ChessPiece p1, ChessPiece p2, ChessPiece p3, ChessPiece p4) const;
+public:
+	ChessPaddedMailbox();
+
+	ChessPiece getPiece(PaddedPosition_t padded) const;
+	void placePiece(BoardPosition_t pos, ChessPiece piece);
+
+	bool isAttacked(BoardPosition_t pos, ChessPlayerColour by) const;
+};
+
+inline ChessPaddedMailbox::PaddedPosition_t ChessPaddedMailbox::toPadded(BoardPosition_t pos)
+{
+	return plainToPadded[pos];
+}
+inline ChessPaddedMailbox::BoardPosition_t ChessPaddedMailbox::toPlain(PaddedPosition_t padded)
+{
+	return paddedToPlain[padded];
+}
+inline ChessPiece ChessPaddedMailbox::getPiece(PaddedPosition_t padded) const
+{
+	return cells[padded];
+}
+
+#endif
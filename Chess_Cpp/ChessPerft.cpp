@@ -0,0 +1,220 @@
+#include "ChessPerft.hpp"
+#include "ChessBoardAnalysis.hpp"
+#include "ChessBoardFactory.hpp"
+#include "ChessPositionCodec.hpp"
+
+#include <thread>
+#include <chrono>
+#include <exception>
+#include <cassert>
+
+// helper
+
+static uint64_t keyOf(ChessBoard::Hash_t hash, unsigned depth) // the same position a different number of moves away is another entry
+{
+	return hash + depth * 0x9E3779B97F4A7C15ull;
+}
+
+// static data members
+
+const unsigned ChessPerft::DEPTH_BITS;
+
+// class functions
+
+double ChessPerft::Result::getRate() const
+{
+	return seconds > 0 ? count / seconds : 0;
+}
+
+ChessPerft::ChessPerft(unsigned threadCount_, size_t hashMegabytes)
+	: threadCount(threadCount_ ? threadCount_ : 1), mask(0), hashHits(0)
+{
+	size_t size = hashMegabytes * 1024 * 1024 / sizeof(Entry);
+	if(size)
+	{
+		while(size & (size-1))
+		{
+			size &= size-1; // down to a power of 2
+		}
+		entries.reset(new Entry[size]);
+		for(size_t i=0; i<size; ++i)
+		{
+			entries[i].check = 0;
+			entries[i].data = 0; // depth 0 is never looked for
+		}
+		mask = size-1;
+	}
+}
+
+bool ChessPerft::probe(ChessBoard::Hash_t hash, unsigned depth, uint64_t &count) const
+{
+	const uint64_t key = keyOf(hash, depth);
+	const Entry &entry = entries[key & mask];
+	const uint64_t data = entry.data.load(std::memory_order_relaxed);
+	const uint64_t check = entry.check.load(std::memory_order_relaxed);
+	if((check ^ data) != key || (data & ((1u << DEPTH_BITS) - 1)) != depth)
+	{
+		return false;
+	}
+	count = data >> DEPTH_BITS;
+	return true;
+}
+
+void ChessPerft::store(ChessBoard::Hash_t hash, unsigned depth, uint64_t count)
+{
+	const uint64_t key = keyOf(hash, depth);
+	const uint64_t data = count << DEPTH_BITS | depth;
+	Entry &entry = entries[key & mask];
+	entry.data.store(data, std::memory_order_relaxed);
+	entry.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+uint64_t ChessPerft::count(ChessBoard::ptr board, unsigned depth)
+{
+	assert(depth > 0);
+	uint64_t result = 0;
+	if(entries && probe(board->getHash(), depth, result))
+	{
+		hashHits.fetch_add(1, std::memory_order_relaxed);
+		return result;
+	}
+	
+	board->makeIFrame();
+	ChessBoardAnalysis* analysis = ChessBoard::getAnalysis(board);
+	analysis->calculatePossibleMoves();
+	const size_t moveCount = analysis->getPossibleMoves()->size();
+	if(depth==1)
+	{
+		result = moveCount; // the last moves are counted, not made
+	}
+	else
+	{
+		for(size_t i=0; i<moveCount; ++i)
+		{
+			result += count(analysis->getPossibleMove(i), depth-1);
+		}
+	}
+	board->clearPossibleMoves();
+	if(board->getFrom())
+	{
+		board->makePFrame(); // its cells go back to the pool
+	}
+	
+	if(entries)
+	{
+		store(board->getHash(), depth, result);
+	}
+	return result;
+}
+
+ChessPerft::Result ChessPerft::run(ChessBoard::ptr board, unsigned depth)
+{
+	Result result{ {}, 0, 0, 0 };
+	hashHits = 0;
+	const auto start = std::chrono::steady_clock::now();
+	
+	if(depth==0)
+	{
+		result.count = 1;
+		return result;
+	}
+	
+	board->makeIFrame();
+	ChessBoardAnalysis* analysis = ChessBoard::getAnalysis(board);
+	analysis->calculatePossibleMoves();
+	for(auto &possibleMove : *analysis->getPossibleMoves())
+	{
+		result.moves.push_back(Divide{ getNotation(possibleMove.move), 0 });
+	}
+	board->clearPossibleMoves();
+	
+	// the analyses are made in the slab of their board, so the threads can't share one:
+	// each of them decodes the root into its own and makes the moves it has taken from it
+	std::vector<uint8_t> root(ChessPositionCodec::getMaxSize());
+	root.resize(ChessPositionCodec::encode(*board, root.data(), root.size()));
+	assert(!root.empty());
+	
+	std::atomic<size_t> next(0);
+	std::vector<std::exception_ptr> errors(threadCount);
+	auto work = [&](unsigned thread)
+	{
+		try
+		{
+			ChessBoardSlab slab;
+			ChessBoardSlab::Scope scope(slab);
+			ChessBoardFactory factory;
+			ChessBoard::ptr copy = factory.createBoard();
+			ChessPositionCodec::decode(root.data(), root.size(), *copy);
+			assert(copy->getHash()==board->getHash());
+			
+			ChessBoardAnalysis* copyAnalysis = ChessBoard::getAnalysis(copy);
+			copyAnalysis->calculatePossibleMoves();
+			assert(copyAnalysis->getPossibleMoves()->size()==result.moves.size());
+			for(size_t i; (i = next++) < result.moves.size(); )
+			{
+				result.moves[i].count = depth==1 ? 1 : count(copyAnalysis->getPossibleMove(i), depth-1);
+			}
+			copy->clearPossibleMoves();
+		}
+		catch(...)
+		{
+			errors[thread] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> threads;
+	for(unsigned thread=1; thread<threadCount; ++thread)
+	{
+		threads.emplace_back(work, thread);
+	}
+	work(0);
+	for(auto &thread : threads)
+	{
+		thread.join();
+	}
+	for(auto &error : errors)
+	{
+		if(error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+	
+	for(auto &divide : result.moves)
+	{
+		result.count += divide.count;
+	}
+	result.hashHits = hashHits;
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+std::string ChessPerft::getNotation(const ChessCompactMove &move)
+{
+	const auto width = ChessBoard::param.width;
+	std::string result;
+	for(ChessBoard::BoardPosition_t pos : { ChessBoard::BoardPosition_t(move.from), ChessBoard::BoardPosition_t(move.to) })
+	{
+		result += (char)('a' + pos % width);
+		result += std::to_string(pos / width + 1);
+	}
+	if(move.promotion!=EMPTY_CELL)
+	{
+		result += chessPieceStrings[move.promotion];
+	}
+	return result;
+}
+
+void ChessPerft::print(std::ostream &os, const Result &result)
+{
+	for(auto &divide : result.moves)
+	{
+		os << divide.move << ": " << divide.count << std::endl;
+	}
+	os << "positions: " << result.count << " in " << result.seconds << " s, "
+		<< (uint64_t)result.getRate() << " per second";
+	if(result.hashHits)
+	{
+		os << ", hash hits: " << result.hashHits;
+	}
+	os << std::endl;
+}
@@ -0,0 +1,65 @@
+#ifndef CHESSPERFT__
+#define CHESSPERFT__
+
+#include "config.hpp"
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+#include "ChessBoard.hpp"
+#include "ChessCompactMove.hpp"
+
+// the count of the positions a number of moves away (perft), to check the move generator against the known
+// counts and to time it, run with "Chess_Cpp perft fen depth [threads] [hash megabytes]".
+// the moves of the root are shared out between the threads, each of them works on its own copy of the root.
+// the counts of the subtrees may be kept by the position hash, in a table of all the threads
+class ChessPerft
+{
+public:
+	struct Divide
+	{
+		std::string move; // the cells from and to, like e2e4
+		uint64_t count; // the positions under it
+	};
+	struct Result
+	{
+		std::vector<Divide> moves; // of the root, in the order of its analysis
+		uint64_t count; // their sum
+		uint64_t hashHits;
+		double seconds;
+
+		double getRate() const; // count per second
+	};
+private:
+	// written and read without a lock: check is the hash xored with data, so a torn entry is not taken
+	struct Entry
+	{
+		std::atomic<uint64_t> check;
+		std::atomic<uint64_t> data; // the count above DEPTH_BITS, the depth below
+	};
+	static const unsigned DEPTH_BITS = 8;
+
+	unsigned threadCount;
+	std::unique_ptr<Entry[]> entries; // nullptr without the hash, the size is a power of 2
+	size_t mask;
+	std::atomic<uint64_t> hashHits;
+
+	bool probe(ChessBoard::Hash_t hash, unsigned depth, uint64_t &count) const;
+	void store(ChessBoard::Hash_t hash, unsigned depth, uint64_t count);
+	uint64_t count(ChessBoard::ptr board, unsigned depth);
+public:
+	ChessPerft(unsigned threadCount=1, size_t hashMegabytes=0);
+	ChessPerft(const ChessPerft &that) = delete;
+	ChessPerft& operator=(const ChessPerft &that) = delete;
+
+	Result run(ChessBoard::ptr board, unsigned depth);
+
+	static std::string getNotation(const ChessCompactMove &move);
+	static void print(std::ostream &os, const Result &result);
+};
+
+#endif
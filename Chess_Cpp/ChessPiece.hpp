@@ -77,8 +77,10 @@ const std::vector<ChessPiece> STANDARD_GAME_PIECES =
 	  PAWN_BLACK, ROOK_BLACK, KNIGHT_BLACK, BISHOP_BLACK, QUEEN_BLACK, KING_BLACK,
 	};
 const std::vector<ChessPiece> CAPABLANCA_GAME_PIECES = 
-	{ PAWN_WHITE, ROOK_WHITE, KNIGHT_WHITE, BISHOP_WHITE, QUEEN_WHITE, KING_WHITE, // TODO: more pieces
+	{ PAWN_WHITE, ROOK_WHITE, KNIGHT_WHITE, BISHOP_WHITE, QUEEN_WHITE, KING_WHITE,
+	  PRINCESS_WHITE, EMPRESS_WHITE, AMAZON_WHITE,
 	  PAWN_BLACK, ROOK_BLACK, KNIGHT_BLACK, BISHOP_BLACK, QUEEN_BLACK, KING_BLACK,
+	  PRINCESS_BLACK, EMPRESS_BLACK, AMAZON_BLACK,
 	};
 
 constexpr ChessPlayerColour getColour(const ChessPiece &cp)
@@ -95,12 +97,18 @@ constexpr ChessPiece charToChessPiece(const char cp)
 		cp=='B' ? BISHOP_WHITE :
 		cp=='Q' ? QUEEN_WHITE :
 		cp=='K' ? KING_WHITE :
+		cp=='C' ? PRINCESS_WHITE :
+		cp=='E' ? EMPRESS_WHITE :
+		cp=='A' ? AMAZON_WHITE :
 		cp=='p' ? PAWN_BLACK :
 		cp=='r' ? ROOK_BLACK :
 		cp=='n' ? KNIGHT_BLACK :
 		cp=='b' ? BISHOP_BLACK :
 		cp=='q' ? QUEEN_BLACK :
 		cp=='k' ? KING_BLACK :
+		cp=='c' ? PRINCESS_BLACK :
+		cp=='e' ? EMPRESS_BLACK :
+		cp=='a' ? AMAZON_BLACK :
 		EMPTY_CELL;
 }
 
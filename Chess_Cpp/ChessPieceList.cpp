@@ -0,0 +1,76 @@
+#include "ChessPieceList.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+// class functions
+
+ChessPieceList::ChessPieceList(BoardPosition_t cellCount)
+	: whiteCount(0), counts{0}
+{
+	counts[EMPTY_CELL] = cellCount;
+	entries.reserve(32);
+}
+
+void ChessPieceList::insert(BoardPosition_t pos, ChessPiece piece)
+{
+	const bool white = getColour(piece)==ChessPlayerColour::WHITE;
+	auto first = white ? entries.begin() : entries.begin()+whiteCount;
+	auto last = white ? entries.begin()+whiteCount : entries.end();
+	auto it = std::lower_bound(first, last, pos,
+		[](const Entry &e, BoardPosition_t p) { return e.pos < p; });
+	entries.insert(it, Entry{pos, piece});
+	if(white)
+	{
+		++whiteCount;
+	}
+}
+
+void ChessPieceList::erase(BoardPosition_t pos, ChessPiece piece)
+{
+	const bool white = getColour(piece)==ChessPlayerColour::WHITE;
+	auto first = white ? entries.begin() : entries.begin()+whiteCount;
+	auto last = white ? entries.begin()+whiteCount : entries.end();
+	auto it = std::lower_bound(first, last, pos,
+		[](const Entry &e, BoardPosition_t p) { return e.pos < p; });
+	assert(it!=last && it->pos==pos && it->piece==piece);
+	entries.erase(it);
+	if(white)
+	{
+		--whiteCount;
+	}
+}
+
+void ChessPieceList::placePiece(BoardPosition_t pos, ChessPiece oldPiece, ChessPiece newPiece)
+{
+	if(oldPiece==newPiece)
+	{
+		return;
+	}
+	--counts[oldPiece];
+	++counts[newPiece];
+
+	if(oldPiece!=EMPTY_CELL && newPiece!=EMPTY_CELL && getColour(oldPiece)==getColour(newPiece))
+	{
+		// the same place in the list
+		auto first = begin(getColour(newPiece)), last = end(getColour(newPiece));
+		auto it = std::lower_bound(first, last, pos,
+			[](const Entry &e, BoardPosition_t p) { return e.pos < p; });
+		assert(it!=last && it->pos==pos);
+		entries[it-entries.begin()].piece = newPiece;
+		return;
+	}
+	if(oldPiece!=EMPTY_CELL)
+	{
+		erase(pos, oldPiece);
+	}
+	if(newPiece!=EMPTY_CELL)
+	{
+		insert(pos, newPiece);
+	}
+}
+
+size_t ChessPieceList::getFootprint() const
+{
+	return sizeof(ChessPieceList) + entries.capacity()*sizeof(Entry);
+}
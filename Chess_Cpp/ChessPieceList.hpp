@@ -0,0 +1,81 @@
+#ifndef CHESSPIECELIST__
+#define CHESSPIECELIST__
+
+#include "config.hpp"
+
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include "ChessPiece.hpp"
+#include "ChessPlayerColour.hpp"
+#include "ChessGameParameters.hpp"
+
+// the occupied cells of the board, for the representations without bitboards:
+// the white pieces first, then the black ones, each colour in the order of the cells
+// (so the moves come out in the same order as from scanning the cell array)
+class ChessPieceList
+{
+public:
+	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+	typedef std::array<int16_t, KNOWN_CHESS_PIECE_COUNT> Counts_t;
+
+	struct Entry // 4 bytes
+	{
+		BoardPosition_t pos;
+		ChessPiece piece;
+	};
+	typedef std::vector<Entry>::const_iterator const_iterator;
+private:
+	std::vector<Entry> entries;
+	size_t whiteCount;
+	Counts_t counts; // [piece], EMPTY_CELL counts the empty cells
+
+	void insert(BoardPosition_t pos, ChessPiece piece);
+	void erase(BoardPosition_t pos, ChessPiece piece);
+public:
+	explicit ChessPieceList(BoardPosition_t cellCount); // an empty board
+
+	void placePiece(BoardPosition_t pos, ChessPiece oldPiece, ChessPiece newPiece);
+
+	const_iterator begin() const;
+	const_iterator end() const;
+	const_iterator begin(ChessPlayerColour colour) const;
+	const_iterator end(ChessPlayerColour colour) const;
+
+	size_t size() const;
+	int16_t count(ChessPiece piece) const;
+	const Counts_t& getCounts() const;
+	size_t getFootprint() const; // bytes, with the list itself
+};
+
+inline ChessPieceList::const_iterator ChessPieceList::begin() const
+{
+	return entries.begin();
+}
+inline ChessPieceList::const_iterator ChessPieceList::end() const
+{
+	return entries.end();
+}
+inline ChessPieceList::const_iterator ChessPieceList::begin(ChessPlayerColour colour) const
+{
+	return colour==ChessPlayerColour::WHITE ? entries.begin() : entries.begin()+whiteCount;
+}
+inline ChessPieceList::const_iterator ChessPieceList::end(ChessPlayerColour colour) const
+{
+	return colour==ChessPlayerColour::WHITE ? entries.begin()+whiteCount : entries.end();
+}
+inline size_t ChessPieceList::size() const
+{
+	return entries.size();
+}
+inline int16_t ChessPieceList::count(ChessPiece piece) const
+{
+	return counts[piece];
+}
+inline const ChessPieceList::Counts_t& ChessPieceList::getCounts() const
+{
+	return counts;
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include "ChessPositionCodec.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+// helper
+
+static const ChessPiece LAST_NARROW_PIECE = EMPRESS_BLACK; // the piece codes are piece-1, so 4 bits are up to 16
+
+static size_t occupancySize(ChessGameParameters::BoardPosition_t cellCount)
+{
+	return (cellCount + 7) / 8;
+}
+
+// static data members
+
+const size_t ChessPositionCodec::HEADER_SIZE;
+const uint8_t ChessPositionCodec::FLAG_BLACK_TO_MOVE;
+const unsigned ChessPositionCodec::CASTLING_SHIFT;
+const uint8_t ChessPositionCodec::FLAG_EN_PASSAN;
+const uint8_t ChessPositionCodec::FLAG_WIDE_PIECES;
+
+// class functions
+
+size_t ChessPositionCodec::getMaxSize()
+{
+	const auto cellCount = ChessBoard::param.cellCount;
+	return HEADER_SIZE + 2 + occupancySize(cellCount) + (cellCount*5 + 7) / 8;
+}
+
+size_t ChessPositionCodec::encode(const ChessBoard &board, uint8_t* out, size_t capacity)
+{
+	const auto cellCount = ChessBoard::param.cellCount;
+	const ChessPiece* cells = board.cells();
+	auto pieceAt = [&](ChessBoard::BoardPosition_t pos) {
+		return cells ? cells[pos] : board.getPieceBeforeChange(pos);
+	};
+
+	size_t pieceCount = 0;
+	bool wide = false;
+	for(ChessBoard::BoardPosition_t pos=0; pos<cellCount; ++pos)
+	{
+		const ChessPiece piece = pieceAt(pos);
+		if(piece!=EMPTY_CELL)
+		{
+			++pieceCount;
+			wide = wide || piece>LAST_NARROW_PIECE;
+		}
+	}
+	const size_t pieceBits = wide ? 5 : 4;
+	const auto enPassan = board.getEnPassan();
+
+	const size_t size = HEADER_SIZE + (enPassan!=cellCount ? 2 : 0) +
+		occupancySize(cellCount) + (pieceCount*pieceBits + 7) / 8;
+	if(size > capacity)
+	{
+		return 0;
+	}
+
+	uint8_t* p = out;
+	*p++ =
+		(board.getTurn()==ChessPlayerColour::BLACK ? FLAG_BLACK_TO_MOVE : 0) |
+		(board.state.castling << CASTLING_SHIFT) |
+		(enPassan!=cellCount ? FLAG_EN_PASSAN : 0) |
+		(wide ? FLAG_WIDE_PIECES : 0);
+	*p++ = (uint8_t)(board.moveNum & 0xFF);
+	*p++ = (uint8_t)(board.moveNum >> 8);
+	if(enPassan!=cellCount)
+	{
+		*p++ = (uint8_t)(enPassan & 0xFF);
+		*p++ = (uint8_t)(enPassan >> 8);
+	}
+
+	uint8_t* occupancy = p;
+	uint8_t* pieces = p + occupancySize(cellCount);
+	std::fill(occupancy, out+size, 0);
+
+	size_t bit = 0; // in pieces
+	for(ChessBoard::BoardPosition_t pos=0; pos<cellCount; ++pos)
+	{
+		const ChessPiece piece = pieceAt(pos);
+		if(piece==EMPTY_CELL)
+		{
+			continue;
+		}
+		occupancy[pos/8] |= 1 << (pos%8);
+
+		// low bits first, a code takes two bytes at most
+		const unsigned code = (unsigned)(piece - 1) << (bit%8);
+		pieces[bit/8] |= (uint8_t)code;
+		if(code >> 8)
+		{
+			pieces[bit/8 + 1] |= (uint8_t)(code >> 8);
+		}
+		bit += pieceBits;
+	}
+	return size;
+}
+
+size_t ChessPositionCodec::decode(const uint8_t* in, size_t size, ChessBoard &board)
+{
+	assert(board.getFromBoard()==nullptr && board.cells()!=nullptr);
+	assert(board.getExtra()->analysis==nullptr);
+
+	const auto cellCount = ChessBoard::param.cellCount;
+	if(size < HEADER_SIZE)
+	{
+		return 0;
+	}
+	const uint8_t* p = in;
+	const uint8_t flags = *p++;
+	const uint16_t moveNum = p[0] | (p[1] << 8);
+	p += 2;
+	ChessBoard::BoardPosition_t enPassan = cellCount;
+	if(flags & FLAG_EN_PASSAN)
+	{
+		if(size < HEADER_SIZE + 2)
+		{
+			return 0;
+		}
+		enPassan = p[0] | (p[1] << 8);
+		p += 2;
+		if(enPassan >= cellCount)
+		{
+			return 0;
+		}
+	}
+
+	const uint8_t* occupancy = p;
+	const uint8_t* pieces = p + occupancySize(cellCount);
+	if((size_t)(pieces - in) > size)
+	{
+		return 0;
+	}
+	size_t pieceCount = 0;
+	for(const uint8_t* o = occupancy; o!=pieces; ++o)
+	{
+		pieceCount += bitCount((uint64_t)*o);
+	}
+	const size_t pieceBits = (flags & FLAG_WIDE_PIECES) ? 5 : 4;
+	const size_t used = (pieces - in) + (pieceCount*pieceBits + 7) / 8;
+	if(used > size)
+	{
+		return 0;
+	}
+
+	board.state.whiteKingPos = board.state.blackKingPos = cellCount;
+	size_t bit = 0;
+	for(ChessBoard::BoardPosition_t pos=0; pos<cellCount; ++pos)
+	{
+		ChessPiece piece = EMPTY_CELL;
+		if(occupancy[pos/8] & (1 << (pos%8)))
+		{
+			unsigned code = pieces[bit/8] >> (bit%8);
+			if(bit%8 + pieceBits > 8)
+			{
+				code |= pieces[bit/8 + 1] << (8 - bit%8);
+			}
+			piece = (ChessPiece)((code & ((1u << pieceBits) - 1)) + 1);
+			bit += pieceBits;
+			if(piece >= KNOWN_CHESS_PIECE_COUNT)
+			{
+				return 0;
+			}
+		}
+		if(board.getPiecePos(pos)!=piece)
+		{
+			board.setCell(pos, piece);
+		}
+		if(piece==KING_WHITE)
+		{
+			board.setKingPos(ChessPlayerColour::WHITE, pos);
+		}
+		else if(piece==KING_BLACK)
+		{
+			board.setKingPos(ChessPlayerColour::BLACK, pos);
+		}
+	}
+
+	board.state.turn = toArrayPosition((flags & FLAG_BLACK_TO_MOVE) ? ChessPlayerColour::BLACK : ChessPlayerColour::WHITE);
+	board.state.castling = (flags >> CASTLING_SHIFT) & 0xF;
+	board.moveNum = moveNum;
+
+	// en passan is read from the changes of the board, so they are made up as the double step over the cell
+	std::fill(board.changes, board.changes+4, ChessBoardChange(cellCount, EMPTY_CELL));
+	board.state.enPassan = 0;
+	if(enPassan!=cellCount)
+	{
+		const bool whiteHasMoved = board.getTurn()==ChessPlayerColour::BLACK;
+		const ChessBoard::BoardPosition_t step = ChessBoard::param.width;
+		const ChessBoard::BoardPosition_t from = whiteHasMoved ? enPassan - step : enPassan + step;
+		const ChessBoard::BoardPosition_t to = whiteHasMoved ? enPassan + step : enPassan - step;
+		if(from >= cellCount || to >= cellCount)
+		{
+			return 0;
+		}
+		board.changes[0] = ChessBoardChange(from, EMPTY_CELL);
+		board.changes[1] = ChessBoardChange(to, board.getPiecePos(to));
+		board.state.enPassan = 1;
+	}
+
+	board.hash = board.calculateHash();
+	return used;
+}
+
+size_t ChessPositionCodec::encode(const ChessBoard::ptr* boards, size_t count, uint8_t* out, size_t capacity)
+{
+	size_t written = 0;
+	for(size_t i=0; i<count; ++i)
+	{
+		const size_t size = encode(*boards[i], out+written, capacity-written);
+		if(!size)
+		{
+			return 0;
+		}
+		written += size;
+	}
+	return written;
+}
+
+size_t ChessPositionCodec::decode(const uint8_t* in, size_t size, const ChessBoard::ptr* boards, size_t count)
+{
+	size_t read = 0;
+	for(size_t i=0; i<count; ++i)
+	{
+		const size_t used = decode(in+read, size-read, *boards[i]);
+		if(!used)
+		{
+			return 0;
+		}
+		read += used;
+	}
+	return read;
+}
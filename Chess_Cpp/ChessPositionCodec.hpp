@@ -0,0 +1,39 @@
+#ifndef CHESSPOSITIONCODEC__
+#define CHESSPOSITIONCODEC__
+
+#include "config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ChessBoard.hpp"
+
+// the binary form of a position, for the current ChessBoard::param (the dimensions and the castling rooks are not stored):
+//   flags: black to move, the 4 castling rights, en passan, 5-bit pieces
+//   the move number, 2 bytes little endian
+//   the en passan cell, 2 bytes little endian, only with the en passan flag
+//   the occupancy, a bit per cell
+//   the pieces of the occupied cells, 4 bits each (5 bits if there are the amazons)
+// 27 bytes for the starting position of 8x8. nothing is allocated, the buffers belong to the caller
+class ChessPositionCodec
+{
+	static const size_t HEADER_SIZE = 3;
+	static const uint8_t FLAG_BLACK_TO_MOVE = 1 << 0;
+	static const unsigned CASTLING_SHIFT = 1; // 4 bits, as in ChessBoard::State
+	static const uint8_t FLAG_EN_PASSAN = 1 << 5;
+	static const uint8_t FLAG_WIDE_PIECES = 1 << 6;
+public:
+	static size_t getMaxSize(); // enough for any position of the current board
+
+	// the bytes written, 0 if the position doesn't fit into capacity. the P-frames are read through their ancestors
+	static size_t encode(const ChessBoard &board, uint8_t* out, size_t capacity);
+	// into a root I-frame without analysis (see ChessBoardFactory::createBoard()),
+	// the bytes read, 0 if the data is short or malformed (then the board is left half-written)
+	static size_t decode(const uint8_t* in, size_t size, ChessBoard &board);
+
+	// one after another, the bytes written (read), 0 if one of them fails
+	static size_t encode(const ChessBoard::ptr* boards, size_t count, uint8_t* out, size_t capacity);
+	static size_t decode(const uint8_t* in, size_t size, const ChessBoard::ptr* boards, size_t count);
+};
+
+#endif
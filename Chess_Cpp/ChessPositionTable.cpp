@@ -0,0 +1,187 @@
+#include "ChessPositionTable.hpp"
+#include "ChessBoard.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+// helper
+
+static ChessBoard* boardAt(ChessBoardSlab::Index_t index)
+{
+	return static_cast<ChessBoard*>(ChessBoardSlab::fromIndex(index));
+}
+
+// static data members
+
+const size_t ChessPositionTable::MIN_CAPACITY;
+
+// class functions
+
+ChessPositionTable::ChessPositionTable()
+	: count(0), shared(0)
+{}
+
+ChessPositionTable* ChessPositionTable::of(const ChessBoard* cb)
+{
+	// the slab first, a board of a frozen one may be destroyed already
+	ChessPositionTable* table = ChessBoardSlab::of(cb).getPositionTable();
+	return table && cb->state.tabled ? table : nullptr;
+}
+
+size_t ChessPositionTable::slotOf(const ChessBoard* cb) const
+{
+	// the zobrist keys are random, the low bits will do
+	return (size_t)cb->getHash() & (entries.size()-1);
+}
+
+bool ChessPositionTable::isSamePosition(const ChessBoard &a, const ChessBoard &b)
+{
+	if(a.getHash()!=b.getHash() || a.moveNum!=b.moveNum ||
+		a.state.whiteKingPos!=b.state.whiteKingPos || a.state.blackKingPos!=b.state.blackKingPos ||
+		a.state.castling!=b.state.castling || a.state.turn!=b.state.turn ||
+		a.getEnPassan()!=b.getEnPassan())
+	{
+		return false;
+	}
+#ifndef NDEBUG
+	for(ChessBoard::BoardPosition_t pos=0; pos<ChessBoard::param.cellCount; ++pos)
+	{
+		assert(a.getPieceBeforeChange(pos)==b.getPieceBeforeChange(pos)); // a hash collision
+	}
+#endif
+	return true;
+}
+
+ChessPositionTable::Entry* ChessPositionTable::findEntry(const ChessBoard* cb)
+{
+	return const_cast<Entry*>(static_cast<const ChessPositionTable*>(this)->findEntry(cb));
+}
+
+const ChessPositionTable::Entry* ChessPositionTable::findEntry(const ChessBoard* cb) const
+{
+	if(entries.empty())
+	{
+		return nullptr;
+	}
+	const ChessBoardSlab::Index_t index = ChessBoardSlab::toIndex(cb);
+	for(size_t slot = slotOf(cb); entries[slot].board!=ChessBoardSlab::NULL_INDEX; slot = (slot+1) & (entries.size()-1))
+	{
+		if(entries[slot].board==index)
+		{
+			return &entries[slot];
+		}
+	}
+	return nullptr;
+}
+
+void ChessPositionTable::grow()
+{
+	std::vector<Entry> old(std::max(MIN_CAPACITY, entries.size()*2), Entry{ChessBoardSlab::NULL_INDEX, 0});
+	old.swap(entries);
+	for(const Entry &e : old)
+	{
+		if(e.board==ChessBoardSlab::NULL_INDEX)
+		{
+			continue;
+		}
+		size_t slot = slotOf(boardAt(e.board));
+		while(entries[slot].board!=ChessBoardSlab::NULL_INDEX)
+		{
+			slot = (slot+1) & (entries.size()-1);
+		}
+		entries[slot] = e;
+	}
+}
+
+ChessBoard* ChessPositionTable::find(const ChessBoard &board)
+{
+	if(entries.empty())
+	{
+		return nullptr;
+	}
+	for(size_t slot = slotOf(&board); entries[slot].board!=ChessBoardSlab::NULL_INDEX; slot = (slot+1) & (entries.size()-1))
+	{
+		ChessBoard* cb = boardAt(entries[slot].board);
+		if(cb!=&board && isSamePosition(*cb, board))
+		{
+			++shared;
+			return cb;
+		}
+	}
+	return nullptr;
+}
+
+void ChessPositionTable::insert(ChessBoard* cb)
+{
+	assert(!cb->state.tabled);
+	if((count+1)*2 > entries.size()) // half full at most, to keep the probes short
+	{
+		grow();
+	}
+	size_t slot = slotOf(cb);
+	while(entries[slot].board!=ChessBoardSlab::NULL_INDEX)
+	{
+		slot = (slot+1) & (entries.size()-1);
+	}
+	entries[slot] = Entry{ChessBoardSlab::toIndex(cb), 1};
+	cb->state.tabled = 1;
+	++count;
+}
+
+void ChessPositionTable::addParent(ChessBoard* cb)
+{
+	Entry* e = findEntry(cb);
+	assert(e!=nullptr);
+	++e->parents;
+}
+
+void ChessPositionTable::removeParent(ChessBoard* cb)
+{
+	Entry* e = findEntry(cb);
+	if(e && e->parents)
+	{
+		--e->parents;
+	}
+}
+
+size_t ChessPositionTable::getParents(const ChessBoard* cb) const
+{
+	const Entry* e = findEntry(cb);
+	return e ? e->parents : 0;
+}
+
+void ChessPositionTable::remove(ChessBoard* cb)
+{
+	cb->state.tabled = 0;
+	Entry* e = findEntry(cb);
+	if(!e)
+	{
+		return; // forgotten by clear()
+	}
+	// shift the following entries of the run back, so no probe stops at the hole
+	const size_t mask = entries.size()-1;
+	size_t hole = e - entries.data();
+	for(size_t slot = (hole+1) & mask; entries[slot].board!=ChessBoardSlab::NULL_INDEX; slot = (slot+1) & mask)
+	{
+		const size_t home = slotOf(boardAt(entries[slot].board));
+		// movable if its home isn't cyclically in (hole, slot]
+		if(((slot - home) & mask) >= ((slot - hole) & mask))
+		{
+			entries[hole] = entries[slot];
+			hole = slot;
+		}
+	}
+	entries[hole] = Entry{ChessBoardSlab::NULL_INDEX, 0};
+	--count;
+}
+
+void ChessPositionTable::clear()
+{
+	entries.clear();
+	count = 0;
+}
+
+ChessPositionTable::Statistics ChessPositionTable::getStatistics() const
+{
+	return Statistics{count, shared};
+}
@@ -0,0 +1,63 @@
+#ifndef CHESSPOSITIONTABLE__
+#define CHESSPOSITIONTABLE__
+
+#include "config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ChessBoardSlab.hpp"
+
+class ChessBoard;
+
+// the hash-consing of the boards of one ChessBoardSlab: a position reached by the different move orders
+// (a transposition) is made once, and the analyses of all its parents share the board and its subtree.
+// the board keeps the parent it has been made from, its changes are counted from it (see ChessBoard::from);
+// the other parents are only counted here. the boards are the same if their hashes, the states and
+// the move numbers are, so the sharing goes between the same plies only and the tree stays acyclic
+class ChessPositionTable
+{
+public:
+	struct Statistics
+	{
+		size_t positions; // the boards in the table
+		uint64_t shared; // the times a board was handed out again instead of being made
+	};
+private:
+	static const size_t MIN_CAPACITY = 1024;
+
+	struct Entry
+	{
+		ChessBoardSlab::Index_t board; // NULL_INDEX for the free entry
+		uint32_t parents; // the analyses holding the board
+	};
+	std::vector<Entry> entries; // open addressing, the capacity is a power of 2
+	size_t count;
+	uint64_t shared;
+
+	size_t slotOf(const ChessBoard* cb) const;
+	Entry* findEntry(const ChessBoard* cb); // nullptr if cb is not in the table
+	const Entry* findEntry(const ChessBoard* cb) const;
+	void grow();
+	static bool isSamePosition(const ChessBoard &a, const ChessBoard &b);
+public:
+	ChessPositionTable();
+	ChessPositionTable(const ChessPositionTable &that) = delete;
+	ChessPositionTable& operator=(const ChessPositionTable &that) = delete;
+
+	static ChessPositionTable* of(const ChessBoard* cb); // the table of the slab of cb, nullptr if cb is not in one
+
+	ChessBoard* find(const ChessBoard &board); // another board of the same position, nullptr if none
+	void insert(ChessBoard* cb); // made by its first parent
+	void addParent(ChessBoard* cb); // handed out by find() to one more parent
+	void removeParent(ChessBoard* cb);
+	size_t getParents(const ChessBoard* cb) const; // 0 if cb is not in the table
+	void remove(ChessBoard* cb); // cb is destroyed, or is not to be handed out anymore
+
+	void clear(); // forget all the boards (they are left alone)
+
+	Statistics getStatistics() const;
+};
+
+#endif
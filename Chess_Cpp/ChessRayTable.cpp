@@ -0,0 +1,68 @@
+#include "ChessRayTable.hpp"
+
+// static data members
+
+ChessRayTable ChessRayTable::takeTables[KNOWN_CHESS_PIECE_COUNT];
+ChessRayTable ChessRayTable::noTakeTables[KNOWN_CHESS_PIECE_COUNT];
+
+// class functions
+
+void ChessRayTable::build(const MoveTemplate &mt, const ChessGameParameters &param)
+{
+	cellRays.assign(1, 0);
+	rayCells.assign(1, 0);
+	cells.clear();
+	for(BoardPosition_t pos=0; pos<param.cellCount; ++pos)
+	{
+		const int file = pos % param.width;
+		const int rank = pos / param.width;
+		for(auto direction = mt.begin(), directionEnd=mt.end(); direction != directionEnd; ++direction)
+		{
+			for(auto attempt = direction->begin(), attemptEnd=direction->end(); attempt != attemptEnd; ++attempt)
+			{
+				const int newFile = file + attempt->first;
+				const int newRank = rank + attempt->second;
+				if(newFile < 0 || newFile >= param.width || newRank < 0 || newRank >= param.height)
+				{
+					break;
+				}
+				cells.push_back(newRank*param.width + newFile);
+			}
+			if(cells.size() != rayCells.back()) // the rays off the board from here are left out
+			{
+				rayCells.push_back(cells.size());
+			}
+		}
+		cellRays.push_back(rayCells.size()-1);
+	}
+	cellRays.shrink_to_fit();
+	rayCells.shrink_to_fit();
+	cells.shrink_to_fit();
+}
+
+void ChessRayTable::init(const ChessGameParameters &param)
+{
+	for(size_t piece=0; piece<KNOWN_CHESS_PIECE_COUNT; ++piece)
+	{
+		auto pieceParam = moveParameters[piece];
+		takeTables[piece].build(pieceParam ? *pieceParam->takeMove : MoveTemplate(), param); // no rays for EMPTY_CELL
+		noTakeTables[piece].build(pieceParam && pieceParam->isDifferentMoveTypes ?
+			*pieceParam->noTakeMove : MoveTemplate(), param);
+	}
+}
+
+size_t ChessRayTable::getFootprint() const
+{
+	return cellRays.capacity()*sizeof(Ray_t) + rayCells.capacity()*sizeof(uint32_t) +
+		cells.capacity()*sizeof(BoardPosition_t);
+}
+
+size_t ChessRayTable::getTotalFootprint()
+{
+	size_t result = 0;
+	for(size_t piece=0; piece<KNOWN_CHESS_PIECE_COUNT; ++piece)
+	{
+		result += takeTables[piece].getFootprint() + noTakeTables[piece].getFootprint();
+	}
+	return result;
+}
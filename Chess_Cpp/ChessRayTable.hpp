@@ -0,0 +1,72 @@
+#ifndef CHESSRAYTABLE__
+#define CHESSRAYTABLE__
+
+#include "config.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#include "ChessPiece.hpp"
+#include "ChessGameParameters.hpp"
+#include "moveTemplate.hpp"
+
+// the cells a MoveTemplate reaches from every cell of the board, already clipped to the board edges:
+// the rays of a cell are [firstRay(pos), endRay(pos)), the cells of a ray are [begin(ray), end(ray)) in the order
+// of the steps, so the generation walks a short array instead of checking the bounds of every step.
+// the tables of the pieces are built once per board geometry, like the ones of ChessPaddedMailbox
+class ChessRayTable
+{
+public:
+	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+	typedef uint32_t Ray_t;
+	typedef const BoardPosition_t* iterator;
+
+	static void init(const ChessGameParameters &param); // build the tables for the board geometry
+
+	static const ChessRayTable& takeRays(ChessPiece piece);
+	static const ChessRayTable& noTakeRays(ChessPiece piece); // only for ChessPieceParameters::isDifferentMoveTypes
+	static size_t getTotalFootprint(); // the bytes of the tables of all the pieces
+
+	Ray_t firstRay(BoardPosition_t pos) const;
+	Ray_t endRay(BoardPosition_t pos) const;
+	iterator begin(Ray_t ray) const;
+	iterator end(Ray_t ray) const;
+
+	size_t getFootprint() const;
+private:
+	static ChessRayTable takeTables[KNOWN_CHESS_PIECE_COUNT];
+	static ChessRayTable noTakeTables[KNOWN_CHESS_PIECE_COUNT];
+
+	std::vector<Ray_t> cellRays; // [pos] the first ray of the cell, [cellCount] is the end
+	std::vector<uint32_t> rayCells; // [ray] the first of its cells, [rayCount] is the end
+	std::vector<BoardPosition_t> cells;
+
+	void build(const MoveTemplate &mt, const ChessGameParameters &param);
+};
+
+inline const ChessRayTable& ChessRayTable::takeRays(ChessPiece piece)
+{
+	return takeTables[piece];
+}
+inline const ChessRayTable& ChessRayTable::noTakeRays(ChessPiece piece)
+{
+	return noTakeTables[piece];
+}
+inline ChessRayTable::Ray_t ChessRayTable::firstRay(BoardPosition_t pos) const
+{
+	return cellRays[pos];
+}
+inline ChessRayTable::Ray_t ChessRayTable::endRay(BoardPosition_t pos) const
+{
+	return cellRays[pos+1];
+}
+inline ChessRayTable::iterator ChessRayTable::begin(Ray_t ray) const
+{
+	return cells.data() + rayCells[ray];
+}
+inline ChessRayTable::iterator ChessRayTable::end(Ray_t ray) const
+{
+	return cells.data() + rayCells[ray+1];
+}
+
+#endif
@@ -0,0 +1,49 @@
+#include "ChessZobrist.hpp"
+
+#include <random>
+
+// static data members
+
+const uint64_t ChessZobrist::SEED;
+
+ChessZobrist::BoardPosition_t ChessZobrist::cellCount = 0;
+std::vector<ChessZobrist::Hash_t> ChessZobrist::pieceKeys;
+ChessZobrist::Hash_t ChessZobrist::blackToMoveKey = 0;
+std::vector<ChessZobrist::Hash_t> ChessZobrist::castlingKeys[2];
+std::vector<ChessZobrist::Hash_t> ChessZobrist::enPassanKeys;
+
+// class functions
+
+void ChessZobrist::init(const ChessGameParameters &param)
+{
+	std::mt19937_64 gen(SEED);
+	
+	cellCount = param.cellCount;
+	
+	pieceKeys.assign(KNOWN_CHESS_PIECE_COUNT*cellCount, 0);
+	for(ChessPiece piece=0; piece<KNOWN_CHESS_PIECE_COUNT; ++piece)
+	{
+		if(piece==EMPTY_CELL) continue; // the empty cells are not hashed
+		for(BoardPosition_t pos=0; pos<cellCount; ++pos)
+		{
+			pieceKeys[piece*cellCount + pos] = gen();
+		}
+	}
+	
+	blackToMoveKey = gen();
+	
+	for(auto &keys : castlingKeys)
+	{
+		keys.assign(cellCount+1, 0);
+		for(BoardPosition_t pos=0; pos<cellCount; ++pos)
+		{
+			keys[pos] = gen();
+		}
+	}
+	
+	enPassanKeys.assign(cellCount+1, 0);
+	for(BoardPosition_t pos=0; pos<cellCount; ++pos)
+	{
+		enPassanKeys[pos] = gen();
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef CHESSZOBRIST__
+#define CHESSZOBRIST__
+
+#include "config.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#include "ChessPiece.hpp"
+#include "ChessPlayerColour.hpp"
+#include "ChessGameParameters.hpp"
+
+// the random keys of the position hash, the hash is the xor of the keys of everything on the board
+class ChessZobrist
+{
+public:
+	typedef uint64_t Hash_t;
+	typedef ChessGameParameters::BoardPosition_t BoardPosition_t;
+
+	static const uint64_t SEED = 0x9E3779B97F4A7C15ull; // fixed, so the hashes are the same from run to run
+
+	static void init(const ChessGameParameters &param); // build the tables for the board geometry
+
+	static Hash_t piece(ChessPiece piece, BoardPosition_t pos);
+	static Hash_t blackToMove();
+	static Hash_t castling(ChessPlayerColour colour, BoardPosition_t pos); // 0 for cellCount (no castling)
+	static Hash_t enPassan(BoardPosition_t pos); // 0 for cellCount (no en passan)
+private:
+	static BoardPosition_t cellCount;
+	static std::vector<Hash_t> pieceKeys; // [piece*cellCount + pos], 0 for EMPTY_CELL
+	static Hash_t blackToMoveKey;
+	static std::vector<Hash_t> castlingKeys[2]; // [colour][pos], [cellCount] is 0
+	static std::vector<Hash_t> enPassanKeys; // [pos], [cellCount] is 0
+};
+
+inline ChessZobrist::Hash_t ChessZobrist::piece(ChessPiece piece, BoardPosition_t pos)
+{
+	return pieceKeys[piece*cellCount + pos];
+}
+inline ChessZobrist::Hash_t ChessZobrist::blackToMove()
+{
+	return blackToMoveKey;
+}
+inline ChessZobrist::Hash_t ChessZobrist::castling(ChessPlayerColour colour, BoardPosition_t pos)
+{
+	return castlingKeys[toArrayPosition(colour)][pos];
+}
+inline ChessZobrist::Hash_t ChessZobrist::enPassan(BoardPosition_t pos)
+{
+	return enPassanKeys[pos];
+}
+
+#endif
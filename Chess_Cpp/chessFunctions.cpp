@@ -0,0 +1,16 @@
+#include "chessFunctions.h"
+#include "ChessBoardAnalysis.hpp"
+
+std::vector<ChessBoard::ptr> ChessFunctions::getPossibleMoves(ChessBoard::ptr cb)
+{
+	cb->makeIFrame();
+	ChessBoardAnalysis* analysis = ChessBoard::getAnalysis(cb);
+	analysis->calculatePossibleMoves();
+	
+	std::vector<ChessBoard::ptr> result;
+	for(size_t i=0, end=analysis->getPossibleMoves()->size(); i<end; ++i)
+	{
+		result.push_back(analysis->getPossibleMove(i));
+	}
+	return result;
+}
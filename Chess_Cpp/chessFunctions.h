@@ -1,6 +1,15 @@
+#ifndef CHESSFUNCTIONS__
+#define CHESSFUNCTIONS__
+
+#include "config.hpp"
+
 #include <vector>
 #include "ChessBoard.hpp"
+
 namespace ChessFunctions
 {
-	std::vector<ChessBoard> getPossibleMoves(ChessBoard cb );
-}
\ No newline at end of file
+	// the positions after each of the legal moves of cb, in the order of its analysis (which keeps them too)
+	std::vector<ChessBoard::ptr> getPossibleMoves(ChessBoard::ptr cb);
+}
+
+#endif
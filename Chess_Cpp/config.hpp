@@ -3,4 +3,16 @@
 
 //#define NDEBUG
 
+// the boards are handed between the threads only while the engine is stopped,
+// define to count the references to the boards atomically anyway
+//#define CHESS_ATOMIC_REFCOUNT
+
+// the attack maps of a board are derived from the ones of its parent,
+// define to compare every derived map with the one calculated from scratch
+//#define CHESS_VERIFY_ATTACK_MAPS
+
+// the boards are bitboards up to 128 cells and padded mailboxes above that,
+// define to have every board a plain mailbox (the cell array and the ray tables only)
+//#define CHESS_FORCE_MAILBOX
+
 #endif
\ No newline at end of file
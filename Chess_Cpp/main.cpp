@@ -4,6 +4,9 @@
 #include "ChessBoard.hpp"
 #include "ChessBoardFactory.hpp"
 #include "ChessEngine.hpp"
+#include "ChessCellArrayPool.hpp"
+#include "ChessBenchmark.hpp"
+#include "ChessPerft.hpp"
 
 #include "Log.hpp"
 
@@ -11,13 +14,48 @@
 
 #include <memory>
 #include <chrono>
+#include <thread>
 
-int main()
+int main(int argc, char** argv)
 {
 	try
 	{
 		ChessBoardFactory factory;
+		if(argc>3 && std::string(argv[1])=="perft")
+		{
+			// perft fen depth [threads] [hash megabytes]
+			auto root = factory.createBoard(argv[2]);
+			ChessPerft perft(argc>4 ? std::stoul(argv[4]) : std::thread::hardware_concurrency(), argc>5 ? std::stoul(argv[5]) : 0);
+			ChessPerft::print(std::cout, perft.run(root, std::stoul(argv[3])));
+			return 0;
+		}
 		auto cb = factory.createBoard("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+		if(argc>1 && std::string(argv[1])=="bench")
+		{
+			ChessBenchmark::print(std::cout, ChessBenchmark::positionCodec(cb, 20000));
+			ChessBenchmark::print(std::cout, ChessBenchmark::moveGeneration(
+				factory.createBoard("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"), 2000));
+			ChessBenchmark::print(std::cout, ChessBenchmark::evaluation(
+				factory.createBoard("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"), 2000));
+			if(ChessBoard::param.representation == ChessBoardRepresentation::BITBOARD)
+			{
+				// the indexing chosen for this processor, then the magics if that was PEXT
+				ChessBenchmark::print(std::cout, ChessMagic::getStatistics());
+				ChessBenchmark::print(std::cout, ChessBenchmark::sliderAttacks(cb, 20000));
+				if(ChessMagic::getStatistics().pext)
+				{
+					ChessMagic::init(ChessBoard::param, false);
+					ChessBenchmark::print(std::cout, ChessMagic::getStatistics());
+					ChessBenchmark::print(std::cout, ChessBenchmark::sliderAttacks(cb, 20000));
+				}
+			}
+			// the other geometries last, a board of another size sets ChessBoard::param for all of them
+			ChessBenchmark::print(std::cout, ChessBenchmark::evaluation(
+				factory.createBoard("rncbqkbenr/pppppppppp/10/10/10/10/PPPPPPPPPP/RNCBQKBENR w KQkq - 0 1"), 2000));
+			ChessBenchmark::print(std::cout, ChessBenchmark::evaluation(
+				factory.createBoard("rnbqkbnr4/pppppppp4/12/12/12/12/12/12/12/12/PPPPPPPP4/RNBQKBNR4 w KQkq - 0 1"), 500));
+			return 0;
+		}
 		//auto cb = factory.createBoard("4k3/8/8/8/8/8/3p4/4K3 b KQkq - 0 1");
 		cb->debugPrint();
 		//ChessBoardAnalysis analysis(cb);
@@ -97,6 +135,14 @@ int main()
 			std::cout << "Number of array recreations: " << ChessBoard::chessBoardArrayRecreateAttemptCount << std::endl;
 			std::cout << "Number of array deletions: " << ChessBoard::chessBoardArrayDeleteCount << std::endl;
 			
+			auto poolStatistics = ChessCellArrayPool::getStatistics();
+			std::cout << "Array pool hits: " << poolStatistics.hits << ", misses: " << poolStatistics.misses << std::endl;
+			std::cout << "Array pool in use: " << poolStatistics.inUse << ", high water: " << poolStatistics.highWater << std::endl;
+			
+			auto memoryStatistics = engine.getMemoryStatistics();
+			std::cout << "Search memory: " << memoryStatistics.used << " bytes, high water: " << memoryStatistics.highWater << std::endl;
+			std::cout << "Demoted I-frames: " << memoryStatistics.demotions << ", released analyses: " << memoryStatistics.releasedAnalyses << std::endl;
+			
 			auto best = engine.getNextBestMove();
 			
 			std::cout << "Is Move Possible: " << std::boolalpha  << ChessMove::isMovePossible(best) << std::endl;
@@ -1,16 +1,20 @@
 #include "moveTemplate.hpp"
+#include "ChessRayTable.hpp"
 
-ChessPieceParameters::ChessPieceParameters(bool differentMoveTypes_, const MoveTemplate* takeMove_,
+ChessPieceParameters::ChessPieceParameters(ChessPiece piece, bool differentMoveTypes_, const MoveTemplate* takeMove_,
 	const MoveTemplate* noTakeMove_, const MoveTemplate* anyMove_)
-		: isDifferentMoveTypes(differentMoveTypes_), takeMove(takeMove_), noTakeMove(noTakeMove_), anyMove(anyMove_)
+		: isDifferentMoveTypes(differentMoveTypes_), takeMove(takeMove_), noTakeMove(noTakeMove_), anyMove(anyMove_),
+		  takeRays(&ChessRayTable::takeRays(piece)),
+		  noTakeRays(differentMoveTypes_ ? &ChessRayTable::noTakeRays(piece) : takeRays),
+		  anyRays(anyMove_ ? takeRays : nullptr)
 {}
 
-ChessPieceParameters::ChessPieceParameters(const MoveTemplate* takeMove_, const MoveTemplate* noTakeMove_)
-	: ChessPieceParameters(true, takeMove_, noTakeMove_, nullptr)
+ChessPieceParameters::ChessPieceParameters(ChessPiece piece, const MoveTemplate* takeMove_, const MoveTemplate* noTakeMove_)
+	: ChessPieceParameters(piece, true, takeMove_, noTakeMove_, nullptr)
 {}
 
-ChessPieceParameters::ChessPieceParameters(const MoveTemplate* anyMove_)
-	: ChessPieceParameters(false, anyMove_, anyMove_, anyMove_)
+ChessPieceParameters::ChessPieceParameters(ChessPiece piece, const MoveTemplate* anyMove_)
+	: ChessPieceParameters(piece, false, anyMove_, anyMove_, anyMove_)
 {}
 
 MoveTemplate combineTwo(const MoveTemplate& a, const MoveTemplate& b)
@@ -127,6 +127,8 @@ const MoveTemplate kingMove =
 	{ std::pair<int, int>(1, -1) }
 };
 
+class ChessRayTable;
+
 struct ChessPieceParameters
 {
 	bool isDifferentMoveTypes;
@@ -134,33 +136,38 @@ struct ChessPieceParameters
 	const MoveTemplate* noTakeMove;
 	const MoveTemplate* anyMove;
 	
-	ChessPieceParameters(bool differentMoveTypes_, const MoveTemplate* takeMove_, const MoveTemplate* noTakeMove_,
+	// the same moves from every cell of the current board (filled by ChessRayTable::init)
+	const ChessRayTable* takeRays;
+	const ChessRayTable* noTakeRays;
+	const ChessRayTable* anyRays;
+	
+	ChessPieceParameters(ChessPiece piece, bool differentMoveTypes_, const MoveTemplate* takeMove_, const MoveTemplate* noTakeMove_,
 		const MoveTemplate* anyMove_);
-	ChessPieceParameters(const MoveTemplate* takeMove_, const MoveTemplate* noTakeMove_);
-	ChessPieceParameters(const MoveTemplate* anyMove_);
+	ChessPieceParameters(ChessPiece piece, const MoveTemplate* takeMove_, const MoveTemplate* noTakeMove_);
+	ChessPieceParameters(ChessPiece piece, const MoveTemplate* anyMove_);
 };
 
 const std::array<const ChessPieceParameters * const, KNOWN_CHESS_PIECE_COUNT> moveParameters =
 	{
 		/* EMPTY_CELL =     */ nullptr,
-		/* PAWN_WHITE =     */ new ChessPieceParameters(&pawnWhiteMoveTake, &pawnWhiteMoveNoTake),
-		/* PAWN_BLACK =     */ new ChessPieceParameters(&pawnBlackMoveTake, &pawnBlackMoveNoTake),
-		/* ROOK_WHITE =     */ new ChessPieceParameters(&rookMove),
-		/* ROOK_BLACK =     */ new ChessPieceParameters(&rookMove),
-		/* KNIGHT_WHITE =   */ new ChessPieceParameters(&knightMove),
-		/* KNIGHT_BLACK =   */ new ChessPieceParameters(&knightMove),
-		/* BISHOP_WHITE =   */ new ChessPieceParameters(&bishopMove),
-		/* BISHOP_BLACK =   */ new ChessPieceParameters(&bishopMove),
-		/* KING_WHITE =     */ new ChessPieceParameters(&kingMove),
-		/* KING_BLACK =     */ new ChessPieceParameters(&kingMove),
-		/* QUEEN_WHITE =    */ new ChessPieceParameters(&queenMove),
-		/* QUEEN_BLACK =    */ new ChessPieceParameters(&queenMove),
-		/* PRINCESS_WHITE = */ new ChessPieceParameters(&princessMove),
-		/* PRINCESS_BLACK = */ new ChessPieceParameters(&princessMove),
-		/* EMPRESS_WHITE =  */ new ChessPieceParameters(&empressMove),
-		/* EMPRESS_BLACK =  */ new ChessPieceParameters(&empressMove),
-		/* AMAZON_WHITE =   */ new ChessPieceParameters(&amazonMove),
-		/* AMAZON_BLACK =   */ new ChessPieceParameters(&amazonMove)
+		/* PAWN_WHITE =     */ new ChessPieceParameters(PAWN_WHITE, &pawnWhiteMoveTake, &pawnWhiteMoveNoTake),
+		/* PAWN_BLACK =     */ new ChessPieceParameters(PAWN_BLACK, &pawnBlackMoveTake, &pawnBlackMoveNoTake),
+		/* ROOK_WHITE =     */ new ChessPieceParameters(ROOK_WHITE, &rookMove),
+		/* ROOK_BLACK =     */ new ChessPieceParameters(ROOK_BLACK, &rookMove),
+		/* KNIGHT_WHITE =   */ new ChessPieceParameters(KNIGHT_WHITE, &knightMove),
+		/* KNIGHT_BLACK =   */ new ChessPieceParameters(KNIGHT_BLACK, &knightMove),
+		/* BISHOP_WHITE =   */ new ChessPieceParameters(BISHOP_WHITE, &bishopMove),
+		/* BISHOP_BLACK =   */ new ChessPieceParameters(BISHOP_BLACK, &bishopMove),
+		/* KING_WHITE =     */ new ChessPieceParameters(KING_WHITE, &kingMove),
+		/* KING_BLACK =     */ new ChessPieceParameters(KING_BLACK, &kingMove),
+		/* QUEEN_WHITE =    */ new ChessPieceParameters(QUEEN_WHITE, &queenMove),
+		/* QUEEN_BLACK =    */ new ChessPieceParameters(QUEEN_BLACK, &queenMove),
+		/* PRINCESS_WHITE = */ new ChessPieceParameters(PRINCESS_WHITE, &princessMove),
+		/* PRINCESS_BLACK = */ new ChessPieceParameters(PRINCESS_BLACK, &princessMove),
+		/* EMPRESS_WHITE =  */ new ChessPieceParameters(EMPRESS_WHITE, &empressMove),
+		/* EMPRESS_BLACK =  */ new ChessPieceParameters(EMPRESS_BLACK, &empressMove),
+		/* AMAZON_WHITE =   */ new ChessPieceParameters(AMAZON_WHITE, &amazonMove),
+		/* AMAZON_BLACK =   */ new ChessPieceParameters(AMAZON_BLACK, &amazonMove)
 	};
 
 #endif